@@ -28,13 +28,74 @@ namespace IA {
         unset          = 0xff000000,  ///< Pixel is below threshold.
         pending        = 0xffff0000,  ///< Pixel is above threshold but is still in the queue.
         voted          = 0xff00ff00,  ///< Pixel has been processed.
-        done           = 0xff0000ff,  ///< Pixel is part of a segment already returned.
-        marked_pending = 0xffff00ff,  ///< Pixel is still in the queue but is part of a candidate segment.
-        marked_voted   = 0xff00ffff   ///< Pixel has been processed but is part of a candidate segment.
+        done           = 0xff0000ff   ///< Pixel is part of a segment already returned.
     };
 
-    using point_t   = simd::double2;
-    using segment_t = simd::double4;
+    /*!
+     * @abstract The vector types of points and segments whose
+     *   coordinates have a given scalar type.
+     * @discussion The scoreboard always reports segments in double
+     *   precision.  The geometry that follows (fusing segments and
+     *   finding corners and regions) is templated on the segment type,
+     *   so that it can be carried out in single precision, with twice
+     *   the lanes per vector and half the memory traffic, when the
+     *   coordinates are small enough; see @c single_precision_suffices.
+     */
+    template <class Scalar> struct geometry;
+
+    template <> struct geometry<double> {
+        using scalar  = double;
+        using point   = simd::double2;
+        using segment = simd::double4;
+
+        static segment from_double(simd::double4 s) {
+            return s;
+        }
+
+        static simd::double4 to_double(segment s) {
+            return s;
+        }
+    };
+
+    template <> struct geometry<float> {
+        using scalar  = float;
+        using point   = simd::float2;
+        using segment = simd::float4;
+
+        static segment from_double(simd::double4 s) {
+            return simd_float(s);
+        }
+
+        static simd::double4 to_double(segment s) {
+            return simd_double(s);
+        }
+    };
+
+    /*!
+     * @abstract The geometry of a segment (or region) type.
+     */
+    template <class Segment> struct segment_geometry;
+
+    template <> struct segment_geometry<simd::double4> : geometry<double> { };
+    template <> struct segment_geometry<simd::float4>  : geometry<float>  { };
+
+    template <class Scalar> using basic_point_t   = typename geometry<Scalar>::point;
+    template <class Scalar> using basic_segment_t = typename geometry<Scalar>::segment;
+
+    using point_t   = basic_point_t<double>;
+    using segment_t = basic_segment_t<double>;
+
+    /*!
+     * @abstract Whether the geometry of segments with coordinates no
+     *   greater than @p extent may be carried out in single precision.
+     * @discussion Below 2^16 a float resolves 1/128 pixel, far finer
+     *   than the channels the segments are found in.
+     * @param extent The greatest coordinate, e.g., the origin of the
+     *   image plus its larger dimension.
+     */
+    static inline bool single_precision_suffices(double extent) {
+        return extent <= 65536.0;
+    }
 
 #define PARAMS(OP,...)  OP(sensitivity,int) __VA_ARGS__ \
                         OP(maxGap,int) __VA_ARGS__ \
@@ -45,9 +106,71 @@ namespace IA {
 #define PARAM_FIELD(X,T) const T X
 #define PARAM_INIT(X,T) X(cf::get<T>(dictionary, CFSTR(#X)))
 
+    // Optional parameters take the default value given here when they
+    // are absent from the dictionary.
+    //
+    // timeLimit        - Seconds to spend voting before returning the
+    //                    segments found so far (0 = unlimited).
+    // maxVotes         - Votes to cast before returning the segments
+    //                    found so far (0 = unlimited).
+    // convergenceVotes - Stop once this many consecutive votes have
+    //                    failed to produce a segment (0 = never).
+    // pyramidLevels    - Find segments on the image downsampled by
+    //                    2^pyramidLevels (at most 3), then refine them
+    //                    at full resolution (0 = off).
+    // tileSize         - Analyze the image in overlapping square tiles
+    //                    of this size to bound memory use (0 = only
+    //                    when a dimension exceeds 65535, in tiles of
+    //                    4096).
+    // memoryBudget     - Bytes the analysis may use, including the
+    //                    border mask intermediates; the accumulator
+    //                    resolution is coarsened and the image tiled
+    //                    as needed to stay within it (0 = unlimited).
+    // angleCount       - Angles per revolution in the accumulator,
+    //                    rounded up to a power of two from 256 to 4096
+    //                    (0 = from the image size, at most 2048).
+    // angularWindow    - Vote only for lines within this many degrees
+    //                    of horizontal or vertical (0 = all angles).
+    // orientationWindow - Each pixel votes only for angles within this
+    //                    many degrees of the edge through it
+    //                    (0 = all angles).
+    // seed             - Seed for the order in which pixels vote, so
+    //                    that results are reproducible (0 = random).
+    // voteBatchSize    - Draw this many pixels at a time, at most
+    //                    4096, and compute their votes in parallel
+    //                    (0 or 1 = one at a time).
+    // standardHough    - Nonzero to use the standard Hough transform,
+    //                    which suits dense edge maps, rather than the
+    //                    progressive one.
+    // hintRadius       - Distance in pixels from each hint given for a
+    //                    warm start within which its line is sought.
+    // doubleGeometry   - Nonzero to fuse segments and find regions in
+    //                    double precision even when single precision
+    //                    suffices.
+
+#define OPTIONAL_PARAMS(OP,...) OP(timeLimit,double,0.0) __VA_ARGS__ \
+                                OP(maxVotes,int,0) __VA_ARGS__ \
+                                OP(convergenceVotes,int,0) __VA_ARGS__ \
+                                OP(pyramidLevels,int,0) __VA_ARGS__ \
+                                OP(tileSize,int,0) __VA_ARGS__ \
+                                OP(memoryBudget,SInt64,0) __VA_ARGS__ \
+                                OP(angleCount,int,0) __VA_ARGS__ \
+                                OP(angularWindow,double,0.0) __VA_ARGS__ \
+                                OP(orientationWindow,double,0.0) __VA_ARGS__ \
+                                OP(seed,int,0) __VA_ARGS__ \
+                                OP(voteBatchSize,int,0) __VA_ARGS__ \
+                                OP(standardHough,int,0) __VA_ARGS__ \
+                                OP(hintRadius,int,8) __VA_ARGS__ \
+                                OP(doubleGeometry,int,0)
+
+#define OPTIONAL_PARAM_NAME(X,T,D) CFSTR(#X)
+#define OPTIONAL_PARAM_FIELD(X,T,D) const T X
+#define OPTIONAL_PARAM_INIT(X,T,D) X(cf::get<T>(dictionary, CFSTR(#X), D))
+
     struct UserParameters {
         PARAMS(PARAM_FIELD,;);
-        UserParameters(CFDictionaryRef dictionary) : PARAMS(PARAM_INIT,,) { }
+        OPTIONAL_PARAMS(OPTIONAL_PARAM_FIELD,;);
+        UserParameters(CFDictionaryRef dictionary) : PARAMS(PARAM_INIT,,), OPTIONAL_PARAMS(OPTIONAL_PARAM_INIT,,) { }
     };
 }
 
@@ -48,6 +48,13 @@ FOUNDATION_EXPORT NSString * const ImageAnalysisKitErrorDomain;
 
 - (nullable NSArray<NSValue *> *)extractSegmentsWithParameters:(NSDictionary<NSString *, id> *)parameters error:(NSError **)error;
 - (nullable NSArray<NSArray<NSNumber *> *> *)extractRegionsWithParameters:(NSDictionary<NSString *, id> *)parameters error:(NSError **)error;
+- (BOOL)extractSegments:(NSArray<NSArray<NSNumber *> *> * _Nullable * _Nonnull)segments regions:(NSArray<NSArray<NSNumber *> *> * _Nullable * _Nonnull)regions withParameters:(NSDictionary<NSString *, id> *)parameters error:(NSError **)error;
+
+- (BOOL)enumerateSegmentsWithParameters:(NSDictionary<NSString *, id> *)parameters fuse:(BOOL)fuse error:(NSError **)error
+                            usingBlock:(void (NS_NOESCAPE ^)(NSUInteger index, vector_double4 segment, BOOL *stop))block;
+
+- (nullable NSData *)extractSegmentDataWithParameters:(NSDictionary<NSString *, id> *)parameters error:(NSError **)error;
+- (nullable NSData *)extractRegionDataWithParameters:(NSDictionary<NSString *, id> *)parameters error:(NSError **)error;
 
 - (nullable CGImageRef)newCGImageAndReturnError:(NSError **)error;
 - (BOOL)writePNGFileToURL:(NSURL *)url error:(NSError **)error;
@@ -321,7 +321,9 @@ NSString * const ImageAnalysisKitErrorDomain = @"ImageAnalysisKitErrorDomain";
         }
     }
 
+    uint64_t span = IATraceBeginSpan();
     vImage_Error code = vImageMax(&buffer, &(result->buffer), NULL, 0, 0, kernelSize.height, kernelSize.width, kvImageNoFlags);
+    IATraceEndSpan("dilate", span);
 
     if (code != kvImageNoError) {
         if (error) *error = [NSError errorWithDomain:ImageAnalysisKitErrorDomain code:code userInfo:nil];
@@ -360,7 +362,9 @@ NSString * const ImageAnalysisKitErrorDomain = @"ImageAnalysisKitErrorDomain";
         }
     }
 
+    uint64_t span = IATraceBeginSpan();
     vImage_Error code = vImageMin(&buffer, &(result->buffer), NULL, 0, 0, kernelSize.height, kernelSize.width, kvImageNoFlags);
+    IATraceEndSpan("erode", span);
 
     if (code != kvImageNoError) {
         if (error) *error = [NSError errorWithDomain:ImageAnalysisKitErrorDomain code:code userInfo:nil];
@@ -435,6 +439,14 @@ NSString * const ImageAnalysisKitErrorDomain = @"ImageAnalysisKitErrorDomain";
 }
 
 - (nullable IABuffer *)extractBorderMaskWithFuzziness:(float)fuzziness ROI:(NSRect)ROI error:(NSError * _Nullable __autoreleasing *)error {
+    uint64_t span = IATraceBeginSpan();
+    IABuffer *mask = [self computeBorderMaskWithFuzziness:fuzziness ROI:ROI error:error];
+    IATraceEndSpan("border_mask", span);
+
+    return mask;
+}
+
+- (nullable IABuffer *)computeBorderMaskWithFuzziness:(float)fuzziness ROI:(NSRect)ROI error:(NSError * _Nullable __autoreleasing *)error {
     CGFloat whitePoint[] = { 0.95047, 1.0, 1.08883 };
     CGFloat blackPoint[] = { 0, 0, 0 };
     CGFloat range[] = { -127, 127, -127, 127 };
@@ -555,6 +567,60 @@ NSString * const ImageAnalysisKitErrorDomain = @"ImageAnalysisKitErrorDomain";
     return regions;
 }
 
+- (BOOL)extractSegments:(NSArray<NSArray<NSNumber *> *> **)segments regions:(NSArray<NSArray<NSNumber *> *> **)regions withParameters:(NSDictionary<NSString *,id> *)parameters error:(NSError **)error {
+    CFErrorRef cfError, *cfErrPtr = error ? &cfError : NULL;
+    CFArrayRef cfSegments, cfRegions;
+
+    if (!IACreateSegmentAndRegionArrays(&buffer, (__bridge CFDictionaryRef)(parameters), &cfSegments, &cfRegions, cfErrPtr)) {
+        if (cfErrPtr) *error = CFBridgingRelease(*cfErrPtr);
+        return NO;
+    }
+
+    *segments = CFBridgingRelease(cfSegments);
+    *regions  = CFBridgingRelease(cfRegions);
+
+    return YES;
+}
+
+static bool IABufferSegmentCallback(CFIndex index, const double *segment, void *info) {
+    void (^block)(NSUInteger, vector_double4, BOOL *) = (__bridge typeof(block))info;
+
+    BOOL stop = NO;
+    block(index, (vector_double4){ segment[0], segment[1], segment[2], segment[3] }, &stop);
+
+    return !stop;
+}
+
+- (BOOL)enumerateSegmentsWithParameters:(NSDictionary<NSString *,id> *)parameters fuse:(BOOL)fuse error:(NSError **)error
+                             usingBlock:(void (NS_NOESCAPE ^)(NSUInteger, vector_double4, BOOL *))block {
+    CFErrorRef cfError, *cfErrPtr = error ? &cfError : NULL;
+
+    IAEnumerationOptions options = fuse ? kIAEnumerationFuseSegments : kIAEnumerationDefault;
+
+    BOOL success = IAEnumerateSegments(&buffer, (__bridge CFDictionaryRef)(parameters), options, IABufferSegmentCallback, (__bridge void *)(block), cfErrPtr);
+    if (!success && cfErrPtr) *error = CFBridgingRelease(*cfErrPtr);
+
+    return success;
+}
+
+- (NSData *)extractSegmentDataWithParameters:(NSDictionary<NSString *,id> *)parameters error:(NSError **)error {
+    CFErrorRef cfError, *cfErrPtr = error ? &cfError : NULL;
+
+    NSData *segments = CFBridgingRelease(IACreateSegmentData(&buffer, (__bridge CFDictionaryRef)(parameters), cfErrPtr));
+    if (!segments && cfErrPtr) *error = CFBridgingRelease(*cfErrPtr);
+
+    return segments;
+}
+
+- (NSData *)extractRegionDataWithParameters:(NSDictionary<NSString *,id> *)parameters error:(NSError **)error {
+    CFErrorRef cfError, *cfErrPtr = error ? &cfError : NULL;
+
+    NSData *regions = CFBridgingRelease(IACreateRegionData(&buffer, (__bridge CFDictionaryRef)(parameters), cfErrPtr));
+    if (!regions && cfErrPtr) *error = CFBridgingRelease(*cfErrPtr);
+
+    return regions;
+}
+
 - (CGImageRef)newCGImageAndReturnError:(NSError **)error {
     vImage_Error code = kvImageNoError;
 
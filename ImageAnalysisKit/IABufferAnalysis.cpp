@@ -7,7 +7,13 @@
 //
 
 #include "IABufferAnalysis.h"
+#include "IAContext.hpp"
+#include "IAMappedBuffer.hpp"
+#include "IAResultCache.hpp"
 #include "IAScoreboard.hpp"
+#include "IASweep.hpp"
+#include "IATiledContext.hpp"
+#include "IATrace.hpp"
 #include "IAPolyline.hpp"
 #include "IAPostprocess.hpp"
 
@@ -15,8 +21,11 @@
 
 #include <simd/simd.h>
 
+#include <algorithm>
 #include <array>
+#include <cerrno>
 #include <iterator>
+#include <memory>
 #include <queue>
 #include <random>
 #include <set>
@@ -108,98 +117,666 @@ CFArrayRef IACopyParameterNames() noexcept {
     return CFArrayCreate(kCFAllocatorDefault, values, numValues, &kCFTypeArrayCallBacks);
 }
 
+CFArrayRef IACopyOptionalParameterNames() noexcept {
+    static CFTypeRef values[] = { OPTIONAL_PARAMS(OPTIONAL_PARAM_NAME,,) };
+    constexpr CFIndex numValues = std::extent<decltype(values)>::value;
+    return CFArrayCreate(kCFAllocatorDefault, values, numValues, &kCFTypeArrayCallBacks);
+}
+
 #define SET_ERROR(X) if (error) *error = (X)
 
-CFArrayRef _Nullable IACreateSegmentArray(const vImage_Buffer *buffer, CFDictionaryRef parameters, CFErrorRef *error) noexcept {
+/*!
+ * @abstract Run a function, translating any exception it throws
+ *   into a @c CFError.
+ * @return The result of the function, or a value-initialized result
+ *   (e.g., @c NULL or @c false) if an exception was thrown.
+ */
+template <class Function>
+static auto capture_errors(CFErrorRef *error, Function &&function) noexcept -> decltype(function()) {
     try {
-        const IA::UserParameters param { parameters };
-
-        CFMutableArrayRef result = CFArrayCreateMutable(kCFAllocatorDefault, 0, &kCFTypeArrayCallBacks);
-
-        IA::Scoreboard scoreboard{buffer, param};
-
-        std::vector<IA::segment_t> segments;
-        std::copy(scoreboard.begin(), scoreboard.end(), std::back_inserter(segments));
-
-        segments.erase(IA::postprocess(segments.begin(), segments.end()), segments.end());
-
-        for (const auto &segment : segments) {
-            auto x0 = cf::number(segment.lo.x);
-            auto y0 = cf::number(segment.lo.y);
-            auto x1 = cf::number(segment.hi.x);
-            auto y1 = cf::number(segment.hi.y);
-
-            auto s = cf::array(x0, y0, x1, y1);
-
-            CFArrayAppendValue(result, s.get());
-        }
-
-        return result;
+        return function();
     }
     catch (const IA::VImageException &ex) {
         SET_ERROR(CFErrorCreate(kCFAllocatorDefault, kCFImageAnalysisKitErrorDomain, ex.code(), NULL));
-        return nullptr;
     }
     catch (const std::system_error &ex) {
         SET_ERROR(cf::system_error(ex));
-        return nullptr;
     }
     catch (const std::exception &ex) {
         SET_ERROR(cf::error(ex));
-        return nullptr;
     }
     catch (...) {
         SET_ERROR(cf::error());
-        return nullptr;
     }
+
+    return decltype(function()) { };
 }
 
-CFArrayRef _Nullable IACreateRegionArray(const vImage_Buffer *buffer, CFDictionaryRef parameters, CFErrorRef *error) noexcept {
-    try {
+SInt64 IAEstimateMemoryUsage(vImagePixelCount width, vImagePixelCount height, CFDictionaryRef parameters, CFErrorRef *error) noexcept {
+    return capture_errors(error, [&] {
         const IA::UserParameters param { parameters };
+        return static_cast<SInt64>(IA::plan_memory(height, width, param).bytes);
+    });
+}
+
+/*!
+ * @abstract Convert segments or regions into a CFArray of CFArrays of
+ *   four CFNumbers.
+ */
+static CFArrayRef create_array(const std::vector<simd::double4> &values) {
+    auto result = cf::make_managed(CFArrayCreateMutable(kCFAllocatorDefault, values.size(), &kCFTypeArrayCallBacks));
+
+    for (const auto &value : values) {
+        auto a = cf::number(value[0]);
+        auto b = cf::number(value[1]);
+        auto c = cf::number(value[2]);
+        auto d = cf::number(value[3]);
+
+        auto v = cf::array(a, b, c, d);
+
+        CFArrayAppendValue(result.get(), v.get());
+    }
 
-        auto result = cf::make_managed(CFArrayCreateMutable(kCFAllocatorDefault, 0, &kCFTypeArrayCallBacks));
+    return result.release();
+}
+
+/*!
+ * @abstract Copy segments or regions into a CFData of packed doubles.
+ */
+static CFDataRef create_data(const std::vector<simd::double4> &values) {
+    static_assert(sizeof(simd::double4) == 4 * sizeof(double), "simd::double4 is not densely packed");
+    return CFDataCreate(kCFAllocatorDefault, reinterpret_cast<const UInt8 *>(values.data()), values.size() * sizeof(simd::double4));
+}
 
-        IA::Scoreboard scoreboard{buffer, param};
+static const std::pair<CFStringRef, IA::stat_counter> counter_keys[] = {
+    { CFSTR("edgePixels"),          &IA::RunStats::edge_pixels },
+    { CFSTR("votes"),               &IA::RunStats::votes },
+    { CFSTR("rejectedVotes"),       &IA::RunStats::votes_rejected },
+    { CFSTR("increments"),          &IA::RunStats::increments },
+    { CFSTR("channelScans"),        &IA::RunStats::channel_scans },
+    { CFSTR("candidates"),          &IA::RunStats::candidates },
+    { CFSTR("discardedCandidates"), &IA::RunStats::candidates_discarded },
+    { CFSTR("unvotedPoints"),       &IA::RunStats::points_unvoted },
+    { CFSTR("staleEntries"),        &IA::RunStats::stale_entries },
+    { CFSTR("rawSegments"),         &IA::RunStats::raw_segments },
+    { CFSTR("segments"),            &IA::RunStats::segments },
+    { CFSTR("corners"),             &IA::RunStats::corners },
+};
+
+static const std::pair<CFStringRef, IA::stat_timer> timer_keys[] = {
+    { CFSTR("setupTime"),       &IA::RunStats::setup_time },
+    { CFSTR("voteTime"),        &IA::RunStats::vote_time },
+    { CFSTR("postprocessTime"), &IA::RunStats::postprocess_time },
+    { CFSTR("regionTime"),      &IA::RunStats::region_time },
+};
+
+/*!
+ * @abstract Convert the counters of an analysis into a CFDictionary.
+ */
+static CFDictionaryRef create_statistics(const IA::RunStats &stats, bool partial) {
+    auto result = cf::make_managed(CFDictionaryCreateMutable(kCFAllocatorDefault, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks));
+
+    for (const auto &key : counter_keys) {
+        CFDictionarySetValue(result.get(), key.first, cf::number(static_cast<SInt64>(stats.*key.second)).get());
+    }
 
-        std::vector<IA::segment_t> segments;
-        std::copy(scoreboard.begin(), scoreboard.end(), std::back_inserter(segments));
+    for (const auto &key : timer_keys) {
+        CFDictionarySetValue(result.get(), key.first, cf::number(stats.*key.second).get());
+    }
 
-        auto end = IA::postprocess(segments.begin(), segments.end());
+    CFDictionarySetValue(result.get(), CFSTR("partial"), partial ? kCFBooleanTrue : kCFBooleanFalse);
 
-        std::vector<IA::Region> regions;
+    return result.release();
+}
 
-        IA::find_regions(segments.begin(), end, std::back_inserter(regions), param.maxGap);
-        IA::sort_regions(regions.begin(), regions.end());
+/*!
+ * @abstract Parse a CFArray of segments in the format made by @c
+ *   create_array.
+ */
+static std::vector<IA::segment_t> parse_segments(CFArrayRef segments) {
+    std::vector<IA::segment_t> result;
 
-        for (auto region : regions) {
-            auto x = cf::number(region[0]);
-            auto y = cf::number(region[1]);
-            auto w = cf::number(region[2]);
-            auto h = cf::number(region[3]);
+    cf::apply(segments, [&result] (CFTypeRef value) {
+        CHECK_CF_TYPE(value, CFArray);
 
-            auto r = cf::array(x, y, w, h);
+        const auto array = static_cast<CFArrayRef>(value);
 
-            CFArrayAppendValue(result.get(), r.get());
+        if (CFArrayGetCount(array) != 4) {
+            throw std::invalid_argument { "A segment must have four coordinates." };
         }
 
-        return result.release();
+        IA::segment_t segment;
+
+        for (CFIndex i = 0; i < 4; ++i) {
+            segment[i] = cf::get<double>(static_cast<CFNumberRef>(CFArrayGetValueAtIndex(array, i)));
+        }
+
+        result.push_back(segment);
+    });
+
+    return result;
+}
+
+/*!
+ * @abstract Create a view of the pixels of a buffer within a
+ *   rectangle, rounded outward to whole pixels.
+ * @param origin Filled with the position of the view.
+ */
+static vImage_Buffer make_roi(const vImage_Buffer *buffer, CGRect rect, IA::point_t &origin) {
+    rect = CGRectIntegral(rect);
+
+    if (CGRectIsNull(rect) || CGRectGetMinX(rect) < 0 || CGRectGetMinY(rect) < 0) {
+        throw IA::VImageException(kvImageRoiLargerThanInputBuffer);
     }
-    catch (const IA::VImageException &ex) {
-        SET_ERROR(CFErrorCreate(kCFAllocatorDefault, kCFImageAnalysisKitErrorDomain, ex.code(), NULL));
-        return nullptr;
+
+    const vImagePixelCount x = CGRectGetMinX(rect);
+    const vImagePixelCount y = CGRectGetMinY(rect);
+
+    origin = IA::point_t { static_cast<double>(x), static_cast<double>(y) };
+
+    return IA::make_roi(*buffer, x, y, CGRectGetWidth(rect), CGRectGetHeight(rect));
+}
+
+CFArrayRef _Nullable IACreateSegmentArray(const vImage_Buffer *buffer, CFDictionaryRef parameters, CFErrorRef *error) noexcept {
+    return capture_errors(error, [&] {
+        const IA::UserParameters param { parameters };
+
+        IA::TiledContext context { buffer->height, buffer->width, param };
+
+        return create_array(context.find_segments(buffer));
+    });
+}
+
+CFArrayRef _Nullable IACreateRegionArray(const vImage_Buffer *buffer, CFDictionaryRef parameters, CFErrorRef *error) noexcept {
+    return capture_errors(error, [&] {
+        const IA::UserParameters param { parameters };
+
+        IA::TiledContext context { buffer->height, buffer->width, param };
+
+        return create_array(context.find_regions(buffer));
+    });
+}
+
+bool IACreateSegmentAndRegionArrays(const vImage_Buffer *buffer, CFDictionaryRef parameters, CFArrayRef *segments, CFArrayRef *regions, CFErrorRef *error) noexcept {
+    return capture_errors(error, [&] {
+        const IA::UserParameters param { parameters };
+
+        IA::TiledContext context { buffer->height, buffer->width, param };
+
+        const auto found = context.find_segments(buffer);
+
+        auto segment_array = cf::make_managed(create_array(found));
+        auto region_array  = cf::make_managed(create_array(context.make_regions(found)));
+
+        *segments = segment_array.release();
+        *regions  = region_array.release();
+
+        return true;
+    });
+}
+
+CFArrayRef _Nullable IACreateSegmentArrayWithStatistics(const vImage_Buffer *buffer, CFDictionaryRef parameters, CFDictionaryRef *statistics, CFErrorRef *error) noexcept {
+    return capture_errors(error, [&] {
+        const IA::UserParameters param { parameters };
+
+        IA::BasicTiledContext<IA::CollectStats> context { buffer->height, buffer->width, param };
+
+        auto result = cf::make_managed(create_array(context.find_segments(buffer)));
+        if (statistics) *statistics = create_statistics(context.statistics(), context.partial());
+
+        return result.release();
+    });
+}
+
+CFArrayRef _Nullable IACreateRegionArrayWithStatistics(const vImage_Buffer *buffer, CFDictionaryRef parameters, CFDictionaryRef *statistics, CFErrorRef *error) noexcept {
+    return capture_errors(error, [&] {
+        const IA::UserParameters param { parameters };
+
+        IA::BasicTiledContext<IA::CollectStats> context { buffer->height, buffer->width, param };
+
+        auto result = cf::make_managed(create_array(context.find_regions(buffer)));
+        if (statistics) *statistics = create_statistics(context.statistics(), context.partial());
+
+        return result.release();
+    });
+}
+
+CFArrayRef _Nullable IACreateSegmentArrayWithHints(const vImage_Buffer *buffer, CFDictionaryRef parameters, CFArrayRef hints, CFErrorRef *error) noexcept {
+    return capture_errors(error, [&] {
+        const IA::UserParameters param { parameters };
+
+        IA::TiledContext context { buffer->height, buffer->width, param };
+        context.set_hints(parse_segments(hints));
+
+        return create_array(context.find_segments(buffer));
+    });
+}
+
+CFArrayRef _Nullable IACreateRegionArrayWithHints(const vImage_Buffer *buffer, CFDictionaryRef parameters, CFArrayRef hints, CFErrorRef *error) noexcept {
+    return capture_errors(error, [&] {
+        const IA::UserParameters param { parameters };
+
+        IA::TiledContext context { buffer->height, buffer->width, param };
+        context.set_hints(parse_segments(hints));
+
+        return create_array(context.find_regions(buffer));
+    });
+}
+
+CFArrayRef _Nullable IACreateSegmentArrayInRect(const vImage_Buffer *buffer, CGRect rect, CFDictionaryRef parameters, CFErrorRef *error) noexcept {
+    return capture_errors(error, [&] {
+        const IA::UserParameters param { parameters };
+
+        IA::point_t origin;
+        const auto roi = make_roi(buffer, rect, origin);
+
+        IA::TiledContext context { roi.height, roi.width, param };
+
+        return create_array(context.find_segments(&roi, origin));
+    });
+}
+
+CFArrayRef _Nullable IACreateRegionArrayInRect(const vImage_Buffer *buffer, CGRect rect, CFDictionaryRef parameters, CFErrorRef *error) noexcept {
+    return capture_errors(error, [&] {
+        const IA::UserParameters param { parameters };
+
+        IA::point_t origin;
+        const auto roi = make_roi(buffer, rect, origin);
+
+        IA::TiledContext context { roi.height, roi.width, param };
+
+        return create_array(context.find_regions(&roi, origin));
+    });
+}
+
+CFDataRef _Nullable IACreateSegmentData(const vImage_Buffer *buffer, CFDictionaryRef parameters, CFErrorRef *error) noexcept {
+    return capture_errors(error, [&] {
+        const IA::UserParameters param { parameters };
+
+        IA::TiledContext context { buffer->height, buffer->width, param };
+
+        return create_data(context.find_segments(buffer));
+    });
+}
+
+CFDataRef _Nullable IACreateRegionData(const vImage_Buffer *buffer, CFDictionaryRef parameters, CFErrorRef *error) noexcept {
+    return capture_errors(error, [&] {
+        const IA::UserParameters param { parameters };
+
+        IA::TiledContext context { buffer->height, buffer->width, param };
+
+        return create_data(context.find_regions(buffer));
+    });
+}
+
+/*!
+ * @abstract Parse a CFArray of parameter dictionaries.
+ */
+static std::vector<IA::UserParameters> parameter_sets(CFArrayRef parameterSets) {
+    std::vector<IA::UserParameters> params;
+
+    cf::apply(parameterSets, [&params] (CFTypeRef value) {
+        CHECK_CF_TYPE(value, CFDictionary);
+        params.emplace_back(static_cast<CFDictionaryRef>(value));
+    });
+
+    return params;
+}
+
+/*!
+ * @abstract Convert the results of a sweep into a CFArray of the
+ *   arrays made by @c create_array.
+ */
+static CFArrayRef create_arrays(const std::vector<std::vector<simd::double4>> &results) {
+    auto result = cf::make_managed(CFArrayCreateMutable(kCFAllocatorDefault, results.size(), &kCFTypeArrayCallBacks));
+
+    for (const auto &values : results) {
+        auto v = cf::make_managed(create_array(values));
+        CFArrayAppendValue(result.get(), v.get());
     }
-    catch (const std::system_error &ex) {
-        SET_ERROR(cf::system_error(ex));
-        return nullptr;
+
+    return result.release();
+}
+
+CFArrayRef _Nullable IACreateSegmentArraysForParameterSets(const vImage_Buffer *buffer, CFArrayRef parameterSets, CFErrorRef *error) noexcept {
+    return capture_errors(error, [&] {
+        return create_arrays(IA::sweep_segments(buffer, parameter_sets(parameterSets)));
+    });
+}
+
+CFArrayRef _Nullable IACreateRegionArraysForParameterSets(const vImage_Buffer *buffer, CFArrayRef parameterSets, CFErrorRef *error) noexcept {
+    return capture_errors(error, [&] {
+        return create_arrays(IA::sweep_regions(buffer, parameter_sets(parameterSets)));
+    });
+}
+
+/*!
+ * @abstract Adapt a row source callback to the form expected by @c
+ *   IA::TiledContext.
+ */
+static auto row_reader(IARowSource source, void *info) {
+    return [source, info] (vImagePixelCount y, vImagePixelCount x, vImagePixelCount count, uint8_t *pixels) {
+        if (!source(y, x, count, pixels, info)) {
+            throw std::system_error(EIO, std::generic_category(), "row source failed");
+        }
+    };
+}
+
+CFArrayRef _Nullable IACreateSegmentArrayFromRowSource(vImagePixelCount width, vImagePixelCount height, IARowSource source, void *info, CFDictionaryRef parameters, CFErrorRef *error) noexcept {
+    return capture_errors(error, [&] {
+        const IA::UserParameters param { parameters };
+
+        IA::TiledContext context { height, width, param };
+
+        return create_array(context.read_segments(row_reader(source, info)));
+    });
+}
+
+CFArrayRef _Nullable IACreateRegionArrayFromRowSource(vImagePixelCount width, vImagePixelCount height, IARowSource source, void *info, CFDictionaryRef parameters, CFErrorRef *error) noexcept {
+    return capture_errors(error, [&] {
+        const IA::UserParameters param { parameters };
+
+        IA::TiledContext context { height, width, param };
+
+        return create_array(context.read_regions(row_reader(source, info)));
+    });
+}
+
+struct __IAMappedImage : IA::mapped_buffer {
+    using IA::mapped_buffer::mapped_buffer;
+};
+
+IAMappedImageRef _Nullable IAMappedImageCreateWithPGMFile(const char *path, CFErrorRef *error) noexcept {
+    return capture_errors(error, [&] {
+        return new __IAMappedImage { path };
+    });
+}
+
+IAMappedImageRef _Nullable IAMappedImageCreateWithRawFile(const char *path, vImagePixelCount width, vImagePixelCount height, size_t rowBytes, size_t offset, CFErrorRef *error) noexcept {
+    return capture_errors(error, [&] {
+        return new __IAMappedImage { path, width, height, rowBytes, offset };
+    });
+}
+
+const vImage_Buffer *IAMappedImageGetBuffer(IAMappedImageRef image) noexcept {
+    return image;
+}
+
+void IAMappedImageRelease(IAMappedImageRef image) noexcept {
+    delete image;
+}
+
+struct __IAResultCache : IA::ResultCache {
+    using IA::ResultCache::ResultCache;
+};
+
+IAResultCacheRef _Nullable IAResultCacheCreate(const char *directory, SInt64 capacity, CFErrorRef *error) noexcept {
+    return capture_errors(error, [&] {
+        return new __IAResultCache { directory, static_cast<std::size_t>(std::max<SInt64>(capacity, 0)) };
+    });
+}
+
+void IAResultCacheRelease(IAResultCacheRef cache) noexcept {
+    delete cache;
+}
+
+/*!
+ * @abstract Look up a result in a cache, computing and storing it on
+ *   a miss.
+ * @param analyze A function taking a @c TiledContext and returning
+ *   the result.
+ */
+template <class Function>
+static std::vector<simd::double4> cached_result(IA::ResultCache &cache, const vImage_Buffer *buffer, const IA::UserParameters &param, IA::ResultCache::kind kind, Function &&analyze) {
+    std::vector<simd::double4> result;
+
+    if (cache.find(buffer, param, kind, result)) return result;
+
+    IA::TiledContext context { buffer->height, buffer->width, param };
+
+    result = analyze(context);
+
+    if (!context.partial()) cache.store(buffer, param, kind, result);
+
+    return result;
+}
+
+CFArrayRef _Nullable IAResultCacheCreateSegmentArray(IAResultCacheRef cache, const vImage_Buffer *buffer, CFDictionaryRef parameters, CFErrorRef *error) noexcept {
+    return capture_errors(error, [&] {
+        const IA::UserParameters param { parameters };
+
+        return create_array(cached_result(*cache, buffer, param, IA::ResultCache::kind::segments, [buffer] (IA::TiledContext &context) {
+            return context.find_segments(buffer);
+        }));
+    });
+}
+
+CFArrayRef _Nullable IAResultCacheCreateRegionArray(IAResultCacheRef cache, const vImage_Buffer *buffer, CFDictionaryRef parameters, CFErrorRef *error) noexcept {
+    return capture_errors(error, [&] {
+        const IA::UserParameters param { parameters };
+
+        return create_array(cached_result(*cache, buffer, param, IA::ResultCache::kind::regions, [buffer] (IA::TiledContext &context) {
+            return context.find_regions(buffer);
+        }));
+    });
+}
+
+struct __IAAnalysisTask {
+    std::shared_ptr<IA::Monitor> monitor;
+};
+
+/*!
+ * @abstract The state of an asynchronous analysis, owned by the
+ *   queued work.
+ */
+struct AsyncAnalysis {
+    const std::shared_ptr<IA::Monitor> monitor;
+    const IA::UserParameters param;
+    const vImage_Buffer buffer;
+    const bool regions;
+    const IACompletionCallback completion;
+    void * const info;
+
+    CFArrayRef analyze() {
+        IA::TiledContext context { buffer.height, buffer.width, param };
+
+        context.set_monitor(monitor.get());
+
+        return regions ? create_array(context.find_regions(&buffer)) : create_array(context.find_segments(&buffer));
     }
-    catch (const std::exception &ex) {
-        SET_ERROR(cf::error(ex));
-        return nullptr;
+
+    static void run(void *context) {
+        std::unique_ptr<AsyncAnalysis> self { static_cast<AsyncAnalysis *>(context) };
+
+        CFErrorRef error = nullptr;
+
+        auto result = cf::make_managed(capture_errors(&error, [&self] {
+            self->monitor->check();
+            return self->analyze();
+        }));
+
+        self->completion(result.get(), error, self->info);
+
+        if (error) CFRelease(error);
     }
-    catch (...) {
-        SET_ERROR(cf::error());
-        return nullptr;
+};
+
+static IAAnalysisTaskRef start_analysis(const vImage_Buffer *buffer, CFDictionaryRef parameters, dispatch_queue_t queue, IAProgressCallback progress, IACompletionCallback completion, void *info, bool regions, CFErrorRef *error) {
+    return capture_errors(error, [&] {
+        auto monitor = std::make_shared<IA::Monitor>(progress, info);
+
+        std::unique_ptr<AsyncAnalysis> analysis { new AsyncAnalysis { monitor, IA::UserParameters { parameters }, *buffer, regions, completion, info } };
+        std::unique_ptr<__IAAnalysisTask> task { new __IAAnalysisTask { monitor } };
+
+        dispatch_async_f(queue, analysis.release(), AsyncAnalysis::run);
+
+        return task.release();
+    });
+}
+
+IAAnalysisTaskRef _Nullable IAAnalysisTaskCreateForSegments(const vImage_Buffer *buffer, CFDictionaryRef parameters, dispatch_queue_t queue, IAProgressCallback progress, IACompletionCallback completion, void *info, CFErrorRef *error) noexcept {
+    return start_analysis(buffer, parameters, queue, progress, completion, info, false, error);
+}
+
+IAAnalysisTaskRef _Nullable IAAnalysisTaskCreateForRegions(const vImage_Buffer *buffer, CFDictionaryRef parameters, dispatch_queue_t queue, IAProgressCallback progress, IACompletionCallback completion, void *info, CFErrorRef *error) noexcept {
+    return start_analysis(buffer, parameters, queue, progress, completion, info, true, error);
+}
+
+void IAAnalysisTaskCancel(IAAnalysisTaskRef task) noexcept {
+    task->monitor->cancel();
+}
+
+void IAAnalysisTaskRelease(IAAnalysisTaskRef task) noexcept {
+    delete task;
+}
+
+/*!
+ * @abstract Deliver the segments found by a context to a C callback.
+ */
+static bool enumerate_segments(IA::TiledContext &context, const vImage_Buffer *buffer, IAEnumerationOptions options, IASegmentCallback callback, void *info) {
+    const bool fused = (options & kIAEnumerationFuseSegments) != 0;
+
+    context.enumerate_segments(buffer, fused, [callback, info] (std::size_t index, const IA::segment_t &segment) {
+        return callback(static_cast<CFIndex>(index), reinterpret_cast<const double *>(&segment), info);
+    });
+
+    return true;
+}
+
+bool IAEnumerateSegments(const vImage_Buffer *buffer, CFDictionaryRef parameters, IAEnumerationOptions options, IASegmentCallback callback, void *info, CFErrorRef *error) noexcept {
+    return capture_errors(error, [&] {
+        const IA::UserParameters param { parameters };
+
+        IA::TiledContext context { buffer->height, buffer->width, param };
+
+        return enumerate_segments(context, buffer, options, callback, info);
+    });
+}
+
+struct __IAAnalysisContext : IA::TiledContext {
+    using IA::TiledContext::TiledContext;
+
+    std::vector<simd::double4> results;
+};
+
+IAAnalysisContextRef _Nullable IAAnalysisContextCreate(vImagePixelCount width, vImagePixelCount height, CFDictionaryRef parameters, CFErrorRef *error) noexcept {
+    return capture_errors(error, [&] {
+        const IA::UserParameters param { parameters };
+        return new __IAAnalysisContext { height, width, param };
+    });
+}
+
+void IAAnalysisContextRelease(IAAnalysisContextRef context) noexcept {
+    delete context;
+}
+
+CFArrayRef _Nullable IAAnalysisContextCreateSegmentArray(IAAnalysisContextRef context, const vImage_Buffer *buffer, CFErrorRef *error) noexcept {
+    return capture_errors(error, [&] {
+        return create_array(context->find_segments(buffer));
+    });
+}
+
+CFArrayRef _Nullable IAAnalysisContextCreateRegionArray(IAAnalysisContextRef context, const vImage_Buffer *buffer, CFErrorRef *error) noexcept {
+    return capture_errors(error, [&] {
+        return create_array(context->find_regions(buffer));
+    });
+}
+
+CFIndex IAAnalysisContextFindSegments(IAAnalysisContextRef context, const vImage_Buffer *buffer, CFErrorRef *error) noexcept {
+    context->results.clear();
+
+    const bool success = capture_errors(error, [&] {
+        context->results = context->find_segments(buffer);
+        return true;
+    });
+
+    return success ? static_cast<CFIndex>(context->results.size()) : kCFNotFound;
+}
+
+CFIndex IAAnalysisContextFindRegions(IAAnalysisContextRef context, const vImage_Buffer *buffer, CFErrorRef *error) noexcept {
+    context->results.clear();
+
+    const bool success = capture_errors(error, [&] {
+        context->results = context->find_regions(buffer);
+        return true;
+    });
+
+    return success ? static_cast<CFIndex>(context->results.size()) : kCFNotFound;
+}
+
+CFIndex IAAnalysisContextFindSegmentsInRect(IAAnalysisContextRef context, const vImage_Buffer *buffer, CGRect rect, CFErrorRef *error) noexcept {
+    context->results.clear();
+
+    const bool success = capture_errors(error, [&] {
+        IA::point_t origin;
+        const auto roi = make_roi(buffer, rect, origin);
+
+        context->results = context->find_segments(&roi, origin);
+        return true;
+    });
+
+    return success ? static_cast<CFIndex>(context->results.size()) : kCFNotFound;
+}
+
+CFIndex IAAnalysisContextFindRegionsInRect(IAAnalysisContextRef context, const vImage_Buffer *buffer, CGRect rect, CFErrorRef *error) noexcept {
+    context->results.clear();
+
+    const bool success = capture_errors(error, [&] {
+        IA::point_t origin;
+        const auto roi = make_roi(buffer, rect, origin);
+
+        context->results = context->find_regions(&roi, origin);
+        return true;
+    });
+
+    return success ? static_cast<CFIndex>(context->results.size()) : kCFNotFound;
+}
+
+bool IAAnalysisContextEnumerateSegments(IAAnalysisContextRef context, const vImage_Buffer *buffer, IAEnumerationOptions options, IASegmentCallback callback, void *info, CFErrorRef *error) noexcept {
+    return capture_errors(error, [&] {
+        return enumerate_segments(*context, buffer, options, callback, info);
+    });
+}
+
+bool IAAnalysisContextIsPartial(IAAnalysisContextRef context) noexcept {
+    return context->partial();
+}
+
+bool IAAnalysisContextSetHints(IAAnalysisContextRef context, CFArrayRef hints, CFErrorRef *error) noexcept {
+    return capture_errors(error, [&] {
+        context->set_hints(parse_segments(hints));
+        return true;
+    });
+}
+
+CFIndex IAAnalysisContextGetResults(IAAnalysisContextRef context, double *values, CFIndex capacity) noexcept {
+    const auto &results = context->results;
+
+    if (values && capacity > 0) {
+        const auto count = std::min<std::size_t>(capacity, results.size());
+        std::copy_n(reinterpret_cast<const double *>(results.data()), 4 * count, values);
     }
 
+    return static_cast<CFIndex>(results.size());
+}
+
+void IATraceSetEnabled(bool enabled) noexcept {
+    IA::trace::enabled.store(enabled);
+}
+
+uint64_t IATraceBeginSpan() noexcept {
+    return IA::trace::enabled.load(std::memory_order_relaxed) ? IA::trace::now() : 0;
+}
+
+void IATraceEndSpan(const char *name, uint64_t token) noexcept {
+    if (token) IA::trace::record(name, token, IA::trace::now());
+}
+
+void IATraceReset() noexcept {
+    IA::trace::clear();
+}
+
+CFDataRef IATraceCopyJSONData() noexcept {
+    const auto json = IA::trace::json();
+    return CFDataCreate(kCFAllocatorDefault, reinterpret_cast<const UInt8 *>(json.data()), json.size());
 }
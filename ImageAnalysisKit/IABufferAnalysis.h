@@ -8,6 +8,7 @@
 
 #import <CoreFoundation/CoreFoundation.h>
 #import <Accelerate/Accelerate.h>
+#import <dispatch/dispatch.h>
 
 CF_ASSUME_NONNULL_BEGIN
 CF_EXTERN_C_BEGIN
@@ -40,6 +41,39 @@ void IAAddAlphaToBuffer(const vImage_Buffer *buffer, vImagePixelCount x, vImageP
  */
 CFArrayRef IACopyParameterNames() _NOEXCEPT;
 
+/*!
+ * @abstract Get the names of the optional parameters.
+ * @discussion These parameters may be omitted from the parameter dictionary, in which case their defaults are used:
+ *   @c timeLimit (seconds of voting before the analysis stops early; 0 for no limit),
+ *   @c maxVotes (votes cast before the analysis stops early; 0 for no limit),
+ *   @c convergenceVotes (consecutive votes without a new segment before the analysis stops early; 0 for no limit),
+ *   @c pyramidLevels (find segments on the image downsampled by 2, 4, or 8 for 1, 2, or 3 levels, then refine each at full resolution; 0 to analyze at full resolution only),
+ *   @c tileSize (analyze the image in overlapping square tiles of this size, which bounds memory use; 0 to tile only images wider or taller than 65535 pixels, in tiles of 4096),
+ *   @c memoryBudget (bytes the analysis may use, including the border mask intermediates; the accumulator resolution is coarsened and the image tiled as needed to stay within it; 0 for no limit),
+ *   @c angleCount (angles per revolution in the accumulator, rounded up to a power of two from 256 to 4096; fewer angles make voting faster and coarser; 0 to choose from the image size, at most 2048),
+ *   @c angularWindow (vote only for lines within this many degrees of horizontal or vertical, which makes voting proportionally faster; lines at other angles are not found; 0 for all angles),
+ *   @c orientationWindow (each pixel votes only for angles within this many degrees of the direction of the edge through it, estimated from its neighbors, which makes most votes much cheaper and sharpens peaks on busy images; 0 for all angles),
+ *   @c seed (seeds the random order in which pixels vote, so that the same image and parameters always give the same results; 0 for a different order each time),
+ *   @c voteBatchSize (draw this many pixels at a time, at most 4096, and compute their votes on several cores, then apply them in the order drawn; the results are statistically equivalent to voting one pixel at a time but not identical to them; 0 or 1 to vote one at a time),
+ *   @c standardHough (nonzero to have every pixel vote at once, on several cores, and then seek segments along the peaks of the accumulator, which is faster on dense edge maps such as textures; @c timeLimit, @c maxVotes, @c convergenceVotes, and @c voteBatchSize do not apply; 0 for the progressive transform),
+ *   @c hintRadius (the distance in pixels from each hint given to IACreateSegmentArrayWithHints() within which its line is sought; default 8), and
+ *   @c doubleGeometry (nonzero to fuse segments and find regions in double precision; by default this is done in single precision when every coordinate is below 65536, which changes results by well under a pixel).
+ *   An analysis stopped by one of these limits returns the segments found so far; see IAAnalysisContextIsPartial().
+ * @return A CFArrayRef of CFStringRef objects.
+ */
+CFArrayRef IACopyOptionalParameterNames() _NOEXCEPT;
+
+/*!
+ * @abstract Estimate the peak memory used to analyze an image.
+ * @discussion The estimate covers the status map, candidate marks, accumulator, and queue of the analysis, assuming the worst case that every pixel is queued, and the intermediate buffers of IABuffer's border mask (21 bytes per pixel), and takes any @c memoryBudget parameter into account.  It does not include the image itself.
+ * @param width The width of the image.
+ * @param height The height of the image.
+ * @param parameters A @c CFDictionary of parameters, as for IACreateSegmentArray().
+ * @param error If not @c NULL and an error occurs, will be filled with the error information.
+ * @return The estimated number of bytes, or 0 if an error occurred.
+ */
+SInt64 IAEstimateMemoryUsage(vImagePixelCount width, vImagePixelCount height, CFDictionaryRef parameters, CFErrorRef *error) _NOEXCEPT;
+
 /*!
  * @abstract Use PPHT to find line segments in an image.
  * @discussion The image is assumed to be in Planar8 format.
@@ -52,7 +86,7 @@ CFArrayRef _Nullable IACreateSegmentArray(const vImage_Buffer *buffer, CFDiction
 
 /*!
  * @abstract Use PPHT to find convex regions in an image.
- * @discussion The image is assumed to be in Planar8 format.
+ * @discussion The image is assumed to be in Planar8 format.  Images wider or taller than 65535 pixels are analyzed in tiles; see the @c tileSize parameter.
  * @param buffer The buffer to analyze.
  * @param parameters A @c CFDictionary of parameters. The keys should be @c CFStringRef objects and the values should be @c CFTypeRef objects. The key names returned by IACopyParameterNames() must be present or the function will fail.
  * @param error If not @c NULL and an error occurs, will be filled with the error information.
@@ -60,6 +94,508 @@ CFArrayRef _Nullable IACreateSegmentArray(const vImage_Buffer *buffer, CFDiction
  */
 CFArrayRef _Nullable IACreateRegionArray(const vImage_Buffer *buffer, CFDictionaryRef parameters, CFErrorRef *error) _NOEXCEPT;
 
+/*!
+ * @abstract Use PPHT to find both the line segments and the convex regions in an image.
+ * @discussion The image is analyzed once, and the regions are formed from the segments returned, so the two always agree.  Calling IACreateSegmentArray() and IACreateRegionArray() instead costs two analyses, which may draw pixels in different orders.
+ * @param buffer The buffer to analyze.
+ * @param parameters A @c CFDictionary of parameters, as for IACreateSegmentArray().
+ * @param segments On success, filled with the segments in the format returned by IACreateSegmentArray(), which the caller must release.
+ * @param regions On success, filled with the regions in the format returned by IACreateRegionArray(), which the caller must release.
+ * @param error If not @c NULL and an error occurs, will be filled with the error information.
+ * @return @c true on success; @c false if an error occurred, in which case neither array is returned.
+ */
+bool IACreateSegmentAndRegionArrays(const vImage_Buffer *buffer, CFDictionaryRef parameters, CFArrayRef _Nullable * _Nonnull segments, CFArrayRef _Nullable * _Nonnull regions, CFErrorRef *error) _NOEXCEPT;
+
+/*!
+ * @abstract Use PPHT to find line segments in an image, reporting what the analysis did.
+ * @discussion Identical to IACreateSegmentArray(), but also counts the work done in each phase.  The statistics dictionary has these keys:
+ *   @c edgePixels (pixels queued for voting),
+ *   @c votes (votes cast),
+ *   @c rejectedVotes (votes that failed the Poisson test),
+ *   @c increments (accumulator cells incremented by those votes),
+ *   @c channelScans (channels scanned for segments),
+ *   @c candidates and @c discardedCandidates (point sets found in those channels, and those not reported as segments),
+ *   @c unvotedPoints (votes withdrawn),
+ *   @c staleEntries (queued pixels already claimed when drawn),
+ *   @c rawSegments and @c segments (segments before and after fusing),
+ *   @c corners (corners found between segments, for regions only),
+ *   @c setupTime, @c voteTime, @c postprocessTime, and @c regionTime (seconds spent in each phase), and
+ *   @c partial (whether the analysis stopped at a limit).
+ * @param buffer The buffer to analyze.
+ * @param parameters A @c CFDictionary of parameters, as for IACreateSegmentArray().
+ * @param statistics If not @c NULL and the analysis succeeds, will be filled with a new @c CFDictionary of statistics, which the caller must release.
+ * @param error If not @c NULL and an error occurs, will be filled with the error information.
+ * @return A CFArrayRef of CFArrayRefs of four CFNumberRefs.
+ */
+CFArrayRef _Nullable IACreateSegmentArrayWithStatistics(const vImage_Buffer *buffer, CFDictionaryRef parameters, CFDictionaryRef _Nullable * _Nullable statistics, CFErrorRef *error) _NOEXCEPT;
+
+/*!
+ * @abstract Use PPHT to find convex regions in an image, reporting what the analysis did.
+ * @discussion Identical to IACreateRegionArray(), but also counts the work done in each phase; see IACreateSegmentArrayWithStatistics().
+ * @param buffer The buffer to analyze.
+ * @param parameters A @c CFDictionary of parameters, as for IACreateSegmentArray().
+ * @param statistics If not @c NULL and the analysis succeeds, will be filled with a new @c CFDictionary of statistics, which the caller must release.
+ * @param error If not @c NULL and an error occurs, will be filled with the error information.
+ * @return A CFArrayRef of CFArrayRefs of four CFNumberRefs: x, y, width, height.
+ */
+CFArrayRef _Nullable IACreateRegionArrayWithStatistics(const vImage_Buffer *buffer, CFDictionaryRef parameters, CFDictionaryRef _Nullable * _Nullable statistics, CFErrorRef *error) _NOEXCEPT;
+
+/*!
+ * @abstract Use PPHT to find line segments in an image similar to one already analyzed.
+ * @discussion Consecutive pages of a book usually share a panel grid.  Before any votes are cast, the line along each hint is sought within @c hintRadius pixels of it, and the segments found along it are committed exactly as if they had been found by voting.  The rest of the image is then analyzed as usual.  When the hints match the image most of the voting is skipped; hints that match nothing cost little.
+ * @param buffer The buffer to analyze, in Planar8 format.
+ * @param parameters A @c CFDictionary of parameters, as for IACreateSegmentArray().
+ * @param hints A @c CFArray of segments in the format returned by IACreateSegmentArray(), typically those of the previous page.
+ * @param error If not @c NULL and an error occurs, will be filled with the error information.
+ * @return A CFArrayRef of CFArrayRefs of four CFNumberRefs.
+ */
+CFArrayRef _Nullable IACreateSegmentArrayWithHints(const vImage_Buffer *buffer, CFDictionaryRef parameters, CFArrayRef hints, CFErrorRef *error) _NOEXCEPT;
+
+/*!
+ * @abstract Use PPHT to find convex regions in an image similar to one already analyzed.
+ * @discussion Identical to IACreateRegionArray(), but starts from the segments of a similar image; see IACreateSegmentArrayWithHints().
+ * @param buffer The buffer to analyze, in Planar8 format.
+ * @param parameters A @c CFDictionary of parameters, as for IACreateSegmentArray().
+ * @param hints A @c CFArray of segments in the format returned by IACreateSegmentArray().
+ * @param error If not @c NULL and an error occurs, will be filled with the error information.
+ * @return A CFArrayRef of CFArrayRefs of four CFNumberRefs: x, y, width, height.
+ */
+CFArrayRef _Nullable IACreateRegionArrayWithHints(const vImage_Buffer *buffer, CFDictionaryRef parameters, CFArrayRef hints, CFErrorRef *error) _NOEXCEPT;
+
+/*!
+ * @abstract Use PPHT to find line segments in one rectangle of an image.
+ * @discussion The rectangle is analyzed in place, without copying its pixels, and the accumulator is sized for the rectangle rather than the whole image.  The rectangle is rounded outward to whole pixels.
+ * @param buffer The buffer to analyze, in Planar8 format.
+ * @param rect The rectangle to analyze, which must lie within the buffer.
+ * @param parameters A @c CFDictionary of parameters, as for IACreateSegmentArray().
+ * @param error If not @c NULL and an error occurs, will be filled with the error information.
+ * @return A CFArrayRef of CFArrayRefs of four CFNumberRefs, in the coordinates of the whole buffer.
+ */
+CFArrayRef _Nullable IACreateSegmentArrayInRect(const vImage_Buffer *buffer, CGRect rect, CFDictionaryRef parameters, CFErrorRef *error) _NOEXCEPT;
+
+/*!
+ * @abstract Use PPHT to find convex regions in one rectangle of an image.
+ * @discussion See IACreateSegmentArrayInRect().
+ * @param buffer The buffer to analyze, in Planar8 format.
+ * @param rect The rectangle to analyze, which must lie within the buffer.
+ * @param parameters A @c CFDictionary of parameters, as for IACreateSegmentArray().
+ * @param error If not @c NULL and an error occurs, will be filled with the error information.
+ * @return A CFArrayRef of CFArrayRefs of four CFNumberRefs: x, y, width, height, in the coordinates of the whole buffer.
+ */
+CFArrayRef _Nullable IACreateRegionArrayInRect(const vImage_Buffer *buffer, CGRect rect, CFDictionaryRef parameters, CFErrorRef *error) _NOEXCEPT;
+
+/*!
+ * @abstract Use PPHT to find line segments in an image.
+ * @discussion Identical to IACreateSegmentArray() except for the form of the result, which avoids allocating an object per number.
+ * @param buffer The buffer to analyze.
+ * @param parameters A @c CFDictionary of parameters, as for IACreateSegmentArray().
+ * @param error If not @c NULL and an error occurs, will be filled with the error information.
+ * @return A CFDataRef containing four doubles per segment: x0, y0, x1, y1.
+ */
+CFDataRef _Nullable IACreateSegmentData(const vImage_Buffer *buffer, CFDictionaryRef parameters, CFErrorRef *error) _NOEXCEPT;
+
+/*!
+ * @abstract Use PPHT to find convex regions in an image.
+ * @discussion Identical to IACreateRegionArray() except for the form of the result, which avoids allocating an object per number.
+ * @param buffer The buffer to analyze.
+ * @param parameters A @c CFDictionary of parameters, as for IACreateSegmentArray().
+ * @param error If not @c NULL and an error occurs, will be filled with the error information.
+ * @return A CFDataRef containing four doubles per region: x, y, width, height.
+ */
+CFDataRef _Nullable IACreateRegionData(const vImage_Buffer *buffer, CFDictionaryRef parameters, CFErrorRef *error) _NOEXCEPT;
+
+/*!
+ * @abstract Use PPHT to find line segments in an image with each of several sets of parameters.
+ * @discussion Meant for tuning parameters.  The image is scanned for edge pixels once, and the variants are analyzed in parallel, each with its own working buffers.  The result for each set of parameters is identical to that of IACreateSegmentArray(), given a fixed @c seed parameter.
+ * @param buffer The buffer to analyze.
+ * @param parameterSets A @c CFArray of @c CFDictionary parameters, each as for IACreateSegmentArray().
+ * @param error If not @c NULL and an error occurs, will be filled with the error information.
+ * @return A CFArrayRef holding, for each set of parameters in order, a CFArrayRef of CFArrayRefs of four CFNumberRefs.
+ */
+CFArrayRef _Nullable IACreateSegmentArraysForParameterSets(const vImage_Buffer *buffer, CFArrayRef parameterSets, CFErrorRef *error) _NOEXCEPT;
+
+/*!
+ * @abstract Use PPHT to find convex regions in an image with each of several sets of parameters.
+ * @discussion See IACreateSegmentArraysForParameterSets().
+ * @param buffer The buffer to analyze.
+ * @param parameterSets A @c CFArray of @c CFDictionary parameters, each as for IACreateSegmentArray().
+ * @param error If not @c NULL and an error occurs, will be filled with the error information.
+ * @return A CFArrayRef holding, for each set of parameters in order, a CFArrayRef of CFArrayRefs of four CFNumberRefs: x, y, width, height.
+ */
+CFArrayRef _Nullable IACreateRegionArraysForParameterSets(const vImage_Buffer *buffer, CFArrayRef parameterSets, CFErrorRef *error) _NOEXCEPT;
+
+/*!
+ * @abstract A function that supplies the pixels of an image too large to hold in memory.
+ * @param y The row to read.
+ * @param x The first column to read.
+ * @param count The number of pixels to read.
+ * @param pixels Where to store the pixels, in Planar8 format.
+ * @param info The pointer given to IACreateSegmentArrayFromRowSource().
+ * @return @c true if the pixels were read, @c false to abandon the analysis.
+ */
+typedef bool (*IARowSource)(vImagePixelCount y, vImagePixelCount x, vImagePixelCount count, uint8_t *pixels, void * _Nullable info);
+
+/*!
+ * @abstract Use PPHT to find line segments in an image read from a row source.
+ * @discussion The image is analyzed in overlapping tiles (see the @c tileSize parameter), and only the current tile is held in memory.  The source may be asked for the same row more than once and in any order, so it should support random access, e.g., by reading from a file.  Images of any size are supported, including those wider or taller than 65535 pixels.
+ * @param width The width of the image.
+ * @param height The height of the image.
+ * @param source The function that supplies the pixels.
+ * @param info A pointer passed to the source.
+ * @param parameters A @c CFDictionary of parameters, as for IACreateSegmentArray().
+ * @param error If not @c NULL and an error occurs, will be filled with the error information.  A source returning @c false produces an @c EIO error in the POSIX domain.
+ * @return A CFArrayRef of CFArrayRefs of four CFNumberRefs.
+ */
+CFArrayRef _Nullable IACreateSegmentArrayFromRowSource(vImagePixelCount width, vImagePixelCount height, IARowSource source, void * _Nullable info, CFDictionaryRef parameters, CFErrorRef *error) _NOEXCEPT;
+
+/*!
+ * @abstract Use PPHT to find convex regions in an image read from a row source.
+ * @discussion See IACreateSegmentArrayFromRowSource().
+ * @param width The width of the image.
+ * @param height The height of the image.
+ * @param source The function that supplies the pixels.
+ * @param info A pointer passed to the source.
+ * @param parameters A @c CFDictionary of parameters, as for IACreateSegmentArray().
+ * @param error If not @c NULL and an error occurs, will be filled with the error information.
+ * @return A CFArrayRef of CFArrayRefs of four CFNumberRefs: x, y, width, height.
+ */
+CFArrayRef _Nullable IACreateRegionArrayFromRowSource(vImagePixelCount width, vImagePixelCount height, IARowSource source, void * _Nullable info, CFDictionaryRef parameters, CFErrorRef *error) _NOEXCEPT;
+
+/*!
+ * @abstract An opaque reference to a memory-mapped Planar8 image.
+ * @discussion The image's buffer points directly into a read-only mapping of the file, so opening it neither decodes nor copies the pixels; pages are read as the analysis touches them.  Suitable for precomputed edge maps.
+ */
+typedef struct __IAMappedImage *IAMappedImageRef;
+
+/*!
+ * @abstract Map a binary (P5) PGM file with eight-bit samples.
+ * @param path The path of the file.
+ * @param error If not @c NULL and an error occurs, will be filled with the error information.  Files that are not eight-bit binary PGM produce @c kvImageInvalidImageFormat.
+ * @return A new mapped image, which must be released with IAMappedImageRelease().
+ */
+IAMappedImageRef _Nullable IAMappedImageCreateWithPGMFile(const char *path, CFErrorRef *error) _NOEXCEPT;
+
+/*!
+ * @abstract Map a file of raw Planar8 pixels.
+ * @param path The path of the file.
+ * @param width The width of the image.
+ * @param height The height of the image.
+ * @param rowBytes The distance in bytes between the starts of rows, or 0 if the rows are packed.
+ * @param offset The position of the first pixel in the file, e.g., the size of a header.
+ * @param error If not @c NULL and an error occurs, will be filled with the error information.  A file too short for the geometry produces @c kvImageBufferSizeMismatch.
+ * @return A new mapped image, which must be released with IAMappedImageRelease().
+ */
+IAMappedImageRef _Nullable IAMappedImageCreateWithRawFile(const char *path, vImagePixelCount width, vImagePixelCount height, size_t rowBytes, size_t offset, CFErrorRef *error) _NOEXCEPT;
+
+/*!
+ * @abstract Get the buffer viewing a mapped image.
+ * @discussion The buffer can be passed to any analysis function.  Its pixels are read-only; writing them crashes.  It is valid until the image is released.
+ * @param image The mapped image.
+ * @return The buffer.
+ */
+const vImage_Buffer *IAMappedImageGetBuffer(IAMappedImageRef image) _NOEXCEPT;
+
+/*!
+ * @abstract Unmap a mapped image.
+ * @param image The image to release.
+ */
+void IAMappedImageRelease(IAMappedImageRef image) _NOEXCEPT;
+
+/*!
+ * @abstract An opaque reference to an on-disk cache of analysis results.
+ * @discussion Results are keyed by a hash of the image's pixels and dimensions and of every parameter, so an unchanged page is never analyzed twice, even by different processes sharing the directory.  Use a fixed @c seed parameter so that results are reproducible.  A cache is thread-safe.
+ */
+typedef struct __IAResultCache *IAResultCacheRef;
+
+/*!
+ * @abstract Open a result cache.
+ * @param directory The directory holding the cache, which is created if necessary.
+ * @param capacity The size in bytes beyond which the least recently used results are removed, or 0 for no limit.
+ * @param error If not @c NULL and an error occurs, will be filled with the error information.
+ * @return A new cache, which must be released with IAResultCacheRelease().
+ */
+IAResultCacheRef _Nullable IAResultCacheCreate(const char *directory, SInt64 capacity, CFErrorRef *error) _NOEXCEPT;
+
+/*!
+ * @abstract Close a result cache.  The results on disk are kept.
+ * @param cache The cache to release.
+ */
+void IAResultCacheRelease(IAResultCacheRef cache) _NOEXCEPT;
+
+/*!
+ * @abstract Use PPHT to find line segments in an image, or find them in a cache.
+ * @discussion Identical to IACreateSegmentArray(), except that the result is looked up in the cache first, and stored in the cache if it is computed.  Results cut short by the @c timeLimit or @c maxVotes parameters are not stored.
+ * @param cache The result cache.
+ * @param buffer The buffer to analyze.
+ * @param parameters A @c CFDictionary of parameters, as for IACreateSegmentArray().
+ * @param error If not @c NULL and an error occurs, will be filled with the error information.
+ * @return A CFArrayRef of CFArrayRefs of four CFNumberRefs.
+ */
+CFArrayRef _Nullable IAResultCacheCreateSegmentArray(IAResultCacheRef cache, const vImage_Buffer *buffer, CFDictionaryRef parameters, CFErrorRef *error) _NOEXCEPT;
+
+/*!
+ * @abstract Use PPHT to find convex regions in an image, or find them in a cache.
+ * @discussion See IAResultCacheCreateSegmentArray().
+ * @param cache The result cache.
+ * @param buffer The buffer to analyze.
+ * @param parameters A @c CFDictionary of parameters, as for IACreateSegmentArray().
+ * @param error If not @c NULL and an error occurs, will be filled with the error information.
+ * @return A CFArrayRef of CFArrayRefs of four CFNumberRefs: x, y, width, height.
+ */
+CFArrayRef _Nullable IAResultCacheCreateRegionArray(IAResultCacheRef cache, const vImage_Buffer *buffer, CFDictionaryRef parameters, CFErrorRef *error) _NOEXCEPT;
+
+/*!
+ * @abstract An opaque reference to an analysis running asynchronously.
+ */
+typedef struct __IAAnalysisTask *IAAnalysisTaskRef;
+
+/*!
+ * @abstract A function told the progress of an asynchronous analysis.
+ * @discussion Called on the analysis queue every few hundred votes, so it should return quickly.
+ * @param fraction The fraction of the analysis done, from 0 to 1.
+ * @param info The pointer given when the analysis was started.
+ */
+typedef void (*IAProgressCallback)(double fraction, void * _Nullable info);
+
+/*!
+ * @abstract A function given the result of an asynchronous analysis.
+ * @discussion Called exactly once, on the analysis queue.  The result and error are released when the function returns; retain them to keep them.
+ * @param result A CFArrayRef as returned by IACreateSegmentArray() or IACreateRegionArray(), or @c NULL if the analysis failed or was cancelled.
+ * @param error The error if the analysis failed, or @c NULL.  A cancelled analysis has the POSIX error @c ECANCELED.
+ * @param info The pointer given when the analysis was started.
+ */
+typedef void (*IACompletionCallback)(CFArrayRef _Nullable result, CFErrorRef _Nullable error, void * _Nullable info);
+
+/*!
+ * @abstract Find line segments in an image without blocking the caller.
+ * @discussion The analysis is identical to IACreateSegmentArray(), but runs on @p queue and checks for cancellation before each vote.  The buffer must remain valid until the completion function is called.
+ * @param buffer The buffer to analyze.
+ * @param parameters A @c CFDictionary of parameters, as for IACreateSegmentArray().  It is read before the function returns.
+ * @param queue The queue on which to run the analysis.
+ * @param progress A function told the progress of the analysis, or @c NULL.
+ * @param completion The function given the result.
+ * @param info A pointer passed to the callbacks.
+ * @param error If not @c NULL and the parameters are invalid, will be filled with the error information.
+ * @return A task, which must be released with IAAnalysisTaskRelease(), or @c NULL if the analysis could not be started, in which case the completion function is not called.
+ */
+IAAnalysisTaskRef _Nullable IAAnalysisTaskCreateForSegments(const vImage_Buffer *buffer, CFDictionaryRef parameters, dispatch_queue_t queue, IAProgressCallback _Nullable progress, IACompletionCallback completion, void * _Nullable info, CFErrorRef *error) _NOEXCEPT;
+
+/*!
+ * @abstract Find convex regions in an image without blocking the caller.
+ * @discussion See IAAnalysisTaskCreateForSegments().
+ * @param buffer The buffer to analyze.
+ * @param parameters A @c CFDictionary of parameters, as for IACreateSegmentArray().
+ * @param queue The queue on which to run the analysis.
+ * @param progress A function told the progress of the analysis, or @c NULL.
+ * @param completion The function given the result.
+ * @param info A pointer passed to the callbacks.
+ * @param error If not @c NULL and the parameters are invalid, will be filled with the error information.
+ * @return A task, which must be released with IAAnalysisTaskRelease().
+ */
+IAAnalysisTaskRef _Nullable IAAnalysisTaskCreateForRegions(const vImage_Buffer *buffer, CFDictionaryRef parameters, dispatch_queue_t queue, IAProgressCallback _Nullable progress, IACompletionCallback completion, void * _Nullable info, CFErrorRef *error) _NOEXCEPT;
+
+/*!
+ * @abstract Cancel an asynchronous analysis.
+ * @discussion The analysis stops at its next vote, and its completion function receives an @c ECANCELED error.  An analysis that has already finished is unaffected.
+ * @param task The task to cancel.
+ */
+void IAAnalysisTaskCancel(IAAnalysisTaskRef task) _NOEXCEPT;
+
+/*!
+ * @abstract Release a task.
+ * @discussion Releasing a task does not cancel it; its completion function is still called.
+ * @param task The task to release.
+ */
+void IAAnalysisTaskRelease(IAAnalysisTaskRef task) _NOEXCEPT;
+
+/*!
+ * @abstract Options for IAEnumerateSegments().
+ * @constant kIAEnumerationFuseSegments Fuse each segment with the segments already delivered.  The callback receives the index and new extent of the segment that absorbed it, so an index may be delivered more than once.
+ */
+typedef CF_OPTIONS(CFOptionFlags, IAEnumerationOptions) {
+    kIAEnumerationDefault      = 0,
+    kIAEnumerationFuseSegments = 1UL << 0
+};
+
+/*!
+ * @abstract A function called for each segment found by IAEnumerateSegments().
+ * @param index The index of the segment.
+ * @param segment Four doubles: x0, y0, x1, y1.
+ * @param info The pointer given to IAEnumerateSegments().
+ * @return @c true to continue the analysis, @c false to stop it.
+ */
+typedef bool (*IASegmentCallback)(CFIndex index, const double *segment, void * _Nullable info);
+
+/*!
+ * @abstract Use PPHT to find line segments in an image, delivering each segment as soon as it is found.
+ * @discussion The callback may stop the analysis early, e.g., once it has the segments forming the page border, which avoids the cost of analyzing the rest of the image.  An image divided into tiles (see the @c tileSize and @c memoryBudget parameters) is enumerated only after every tile has been analyzed, and its segments are always fused.
+ * @param buffer The buffer to analyze.
+ * @param parameters A @c CFDictionary of parameters, as for IACreateSegmentArray().
+ * @param options Enumeration options.
+ * @param callback The function to call for each segment.
+ * @param info A pointer passed to the callback.
+ * @param error If not @c NULL and an error occurs, will be filled with the error information.
+ * @return @c true if the enumeration completed or was stopped by the callback; @c false if an error occurred.
+ */
+bool IAEnumerateSegments(const vImage_Buffer *buffer, CFDictionaryRef parameters, IAEnumerationOptions options, IASegmentCallback callback, void * _Nullable info, CFErrorRef *error) _NOEXCEPT;
+
+/*!
+ * @abstract An opaque, reusable analysis context.
+ * @discussion A context holds the parsed parameters and the working
+ *   buffers for images of one size.  Analyzing a sequence of
+ *   same-sized pages through a single context avoids reparsing the
+ *   parameters and reallocating and clearing the working buffers for
+ *   each page.  A context is not thread-safe; use one per thread.
+ */
+typedef struct __IAAnalysisContext *IAAnalysisContextRef;
+
+/*!
+ * @abstract Create a reusable analysis context.
+ * @param width The width of the images that will be analyzed.
+ * @param height The height of the images that will be analyzed.
+ * @param parameters A @c CFDictionary of parameters, as for IACreateSegmentArray().  The @c tileSize and @c memoryBudget parameters are honored as they are by IACreateSegmentArray().
+ * @param error If not @c NULL and an error occurs, will be filled with the error information.
+ * @return A new context, which must be released with IAAnalysisContextRelease().
+ */
+IAAnalysisContextRef _Nullable IAAnalysisContextCreate(vImagePixelCount width, vImagePixelCount height, CFDictionaryRef parameters, CFErrorRef *error) _NOEXCEPT;
+
+/*!
+ * @abstract Destroy an analysis context.
+ * @param context The context to destroy.
+ */
+void IAAnalysisContextRelease(IAAnalysisContextRef context) _NOEXCEPT;
+
+/*!
+ * @abstract Use PPHT to find line segments in an image using a reusable context.
+ * @param context The analysis context.
+ * @param buffer The buffer to analyze.  It must be in Planar8 format and have the dimensions given when the context was created.
+ * @param error If not @c NULL and an error occurs, will be filled with the error information.
+ * @return A CFArrayRef of CFArrayRefs of four CFNumberRefs.
+ */
+CFArrayRef _Nullable IAAnalysisContextCreateSegmentArray(IAAnalysisContextRef context, const vImage_Buffer *buffer, CFErrorRef *error) _NOEXCEPT;
+
+/*!
+ * @abstract Use PPHT to find convex regions in an image using a reusable context.
+ * @param context The analysis context.
+ * @param buffer The buffer to analyze.  It must be in Planar8 format and have the dimensions given when the context was created.
+ * @param error If not @c NULL and an error occurs, will be filled with the error information.
+ * @return A CFArrayRef of CFArrayRefs of four CFNumberRefs: x, y, width, height.
+ */
+CFArrayRef _Nullable IAAnalysisContextCreateRegionArray(IAAnalysisContextRef context, const vImage_Buffer *buffer, CFErrorRef *error) _NOEXCEPT;
+
+/*!
+ * @abstract Use PPHT to find line segments in an image, keeping the results in the context.
+ * @discussion The results can be retrieved with IAAnalysisContextGetResults() and remain valid until the next analysis.
+ * @param context The analysis context.
+ * @param buffer The buffer to analyze.  It must be in Planar8 format and have the dimensions given when the context was created.
+ * @param error If not @c NULL and an error occurs, will be filled with the error information.
+ * @return The number of segments found, or @c kCFNotFound if an error occurred.
+ */
+CFIndex IAAnalysisContextFindSegments(IAAnalysisContextRef context, const vImage_Buffer *buffer, CFErrorRef *error) _NOEXCEPT;
+
+/*!
+ * @abstract Use PPHT to find convex regions in an image, keeping the results in the context.
+ * @discussion The results can be retrieved with IAAnalysisContextGetResults() and remain valid until the next analysis.
+ * @param context The analysis context.
+ * @param buffer The buffer to analyze.  It must be in Planar8 format and have the dimensions given when the context was created.
+ * @param error If not @c NULL and an error occurs, will be filled with the error information.
+ * @return The number of regions found, or @c kCFNotFound if an error occurred.
+ */
+CFIndex IAAnalysisContextFindRegions(IAAnalysisContextRef context, const vImage_Buffer *buffer, CFErrorRef *error) _NOEXCEPT;
+
+/*!
+ * @abstract Use PPHT to find line segments in one rectangle of an image, keeping the results in the context.
+ * @discussion See IACreateSegmentArrayInRect().
+ * @param context The analysis context.
+ * @param buffer The buffer to analyze, in Planar8 format.
+ * @param rect The rectangle to analyze.  It must lie within the buffer and, once rounded outward to whole pixels, have the dimensions given when the context was created.
+ * @param error If not @c NULL and an error occurs, will be filled with the error information.
+ * @return The number of segments found, or @c kCFNotFound if an error occurred.
+ */
+CFIndex IAAnalysisContextFindSegmentsInRect(IAAnalysisContextRef context, const vImage_Buffer *buffer, CGRect rect, CFErrorRef *error) _NOEXCEPT;
+
+/*!
+ * @abstract Use PPHT to find convex regions in one rectangle of an image, keeping the results in the context.
+ * @discussion See IACreateSegmentArrayInRect().
+ * @param context The analysis context.
+ * @param buffer The buffer to analyze, in Planar8 format.
+ * @param rect The rectangle to analyze.  It must lie within the buffer and, once rounded outward to whole pixels, have the dimensions given when the context was created.
+ * @param error If not @c NULL and an error occurs, will be filled with the error information.
+ * @return The number of regions found, or @c kCFNotFound if an error occurred.
+ */
+CFIndex IAAnalysisContextFindRegionsInRect(IAAnalysisContextRef context, const vImage_Buffer *buffer, CGRect rect, CFErrorRef *error) _NOEXCEPT;
+
+/*!
+ * @abstract Use PPHT to find line segments in an image using a reusable context, delivering each segment as soon as it is found.
+ * @param context The analysis context.
+ * @param buffer The buffer to analyze.  It must be in Planar8 format and have the dimensions given when the context was created.
+ * @param options Enumeration options.
+ * @param callback The function to call for each segment.
+ * @param info A pointer passed to the callback.
+ * @param error If not @c NULL and an error occurs, will be filled with the error information.
+ * @return @c true if the enumeration completed or was stopped by the callback; @c false if an error occurred.
+ * @see IAEnumerateSegments
+ */
+bool IAAnalysisContextEnumerateSegments(IAAnalysisContextRef context, const vImage_Buffer *buffer, IAEnumerationOptions options, IASegmentCallback callback, void * _Nullable info, CFErrorRef *error) _NOEXCEPT;
+
+/*!
+ * @abstract Determine whether the last analysis was cut short.
+ * @param context The analysis context.
+ * @return @c true if the last analysis stopped because it reached the @c timeLimit, @c maxVotes, or @c convergenceVotes limit, in which case its results are incomplete.
+ */
+bool IAAnalysisContextIsPartial(IAAnalysisContextRef context) _NOEXCEPT;
+
+/*!
+ * @abstract Start each later analysis through a context from the segments of a similar image.
+ * @discussion The hints apply to every analysis until replaced; see IACreateSegmentArrayWithHints().  Pass the segments of each page as the hints for the next to follow a book's panel grid from page to page.
+ * @param context The analysis context.
+ * @param hints A @c CFArray of segments in the format returned by IAAnalysisContextCreateSegmentArray(), or an empty array to analyze from scratch.
+ * @param error If not @c NULL and an error occurs, will be filled with the error information.
+ * @return @c true if the hints were accepted.
+ */
+bool IAAnalysisContextSetHints(IAAnalysisContextRef context, CFArrayRef hints, CFErrorRef *error) _NOEXCEPT;
+
+/*!
+ * @abstract Copy the results of the last analysis into a caller-provided buffer.
+ * @discussion Each result occupies four consecutive doubles: x0, y0, x1, y1 for segments, or x, y, width, height for regions.  Pass @c NULL for @p values to query the number of results without copying.
+ * @param context The analysis context.
+ * @param values A buffer with room for @c 4*capacity doubles, or @c NULL.
+ * @param capacity The number of results that @p values can hold.
+ * @return The number of results available, which may exceed @p capacity.
+ */
+CFIndex IAAnalysisContextGetResults(IAAnalysisContextRef context, double * _Nullable values, CFIndex capacity) _NOEXCEPT;
+
+/*!
+ * @abstract Turn timeline tracing on or off.
+ * @discussion While tracing is on, each phase of an analysis (thresholding, voting, postprocessing, region finding, and so on) is recorded with its thread and duration in a ring buffer owned by that thread.  Tracing is off by default; when off, it costs almost nothing.
+ * @param enabled Whether to record.
+ */
+void IATraceSetEnabled(bool enabled) _NOEXCEPT;
+
+/*!
+ * @abstract Start timing a span of work done outside the library.
+ * @return A token to pass to IATraceEndSpan(), or 0 if tracing is off.
+ */
+uint64_t IATraceBeginSpan(void) _NOEXCEPT;
+
+/*!
+ * @abstract Record a span of work done outside the library.
+ * @param name The name of the span.  It must be a string constant without quotes or backslashes; only the pointer is kept.
+ * @param token The value returned by IATraceBeginSpan().  Nothing is recorded if it is 0.
+ */
+void IATraceEndSpan(const char *name, uint64_t token) _NOEXCEPT;
+
+/*!
+ * @abstract Discard the spans recorded so far on all threads.
+ */
+void IATraceReset(void) _NOEXCEPT;
+
+/*!
+ * @abstract Get the spans recorded on all threads since tracing was enabled or last reset.
+ * @return UTF-8 JSON in the Chrome trace event format, which can be loaded into chrome://tracing or Perfetto.
+ */
+CFDataRef IATraceCopyJSONData(void) _NOEXCEPT;
+
 CF_EXTERN_C_END
 CF_ASSUME_NONNULL_END
 
@@ -0,0 +1,207 @@
+//
+//  IAContext.cpp
+//  ImageAnalysisKit
+//
+//  Created by Rob Menke on 10/18/26.
+//  Copyright © 2026 Rob Menke. All rights reserved.
+//
+
+#include "IAContext.hpp"
+#include "IAPostprocess.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace IA {
+    static unsigned pyramid_scale(const UserParameters &param) {
+        return 1U << std::min(std::max(param.pyramidLevels, 0), 3);
+    }
+
+    template <class Stats>
+    BasicContext<Stats>::BasicContext(vImagePixelCount height, vImagePixelCount width, const UserParameters &param, Resolution resolution) : param(param), scoreboard(height, width, param, resolution), scale(pyramid_scale(param)) {
+        if (scale == 1) return;
+
+        const vImagePixelCount coarse_height = (height + scale - 1) / scale;
+        const vImagePixelCount coarse_width  = (width  + scale - 1) / scale;
+
+        const double min_length = static_cast<double>(param.minSegmentLength) / scale;
+        const unsigned short max_gap = std::max(param.maxGap / static_cast<int>(scale), 1);
+
+        coarse_image.reset(new managed_buffer<uint8_t>(coarse_height, coarse_width));
+        coarse.reset(new BasicScoreboard<Stats>(coarse_height, coarse_width, param.sensitivity * -M_LN10, min_length * min_length, std::ceil(std::hypot(coarse_width, coarse_height)), max_gap, 1));
+        coarse->set_limits(param.timeLimit, std::max(param.maxVotes, 0), std::max(param.convergenceVotes, 0));
+        coarse->set_angular_window(param.angularWindow);
+        coarse->set_orientation_window(param.orientationWindow);
+        coarse->set_seed(param.seed);
+        coarse->set_vote_batch(std::max(param.voteBatchSize, 1));
+        coarse->set_standard(param.standardHough != 0);
+    }
+
+    template <class Stats>
+    std::size_t BasicContext<Stats>::footprint(vImagePixelCount height, vImagePixelCount width, const UserParameters &param, Resolution resolution) {
+        const double diagonal = std::ceil(std::hypot(width, height));
+
+        if (resolution.angles == 0) resolution.angles = angle_count(diagonal, param.angleCount);
+
+        std::size_t bytes = BasicScoreboard<Stats>::footprint(height, width, diagonal, resolution);
+
+        // The orientation planes of the scoreboards, if any, are half
+        // the size of the status maps.
+
+        const std::size_t orientation = param.orientationWindow > 0 ? sizeof(uint16_t) : 0;
+
+        bytes += height * width * orientation;
+
+        // The curves traced for a vote batch, two bytes per angle per
+        // pixel drawn.
+
+        const vImagePixelCount batch = param.standardHough ? 1 : std::min<vImagePixelCount>(std::max(param.voteBatchSize, 1), BasicScoreboard<Stats>::max_vote_batch());
+        const std::size_t curves = batch > 1 ? batch * sizeof(uint16_t) : 0;
+
+        bytes += curves * resolution.angles;
+
+        const unsigned scale = pyramid_scale(param);
+
+        if (scale > 1) {
+            const vImagePixelCount coarse_height = (height + scale - 1) / scale;
+            const vImagePixelCount coarse_width  = (width  + scale - 1) / scale;
+
+            bytes += coarse_height * coarse_width;
+            bytes += BasicScoreboard<Stats>::footprint(coarse_height, coarse_width, std::ceil(std::hypot(coarse_width, coarse_height)));
+            bytes += coarse_height * coarse_width * orientation;
+            bytes += curves * angle_count(std::ceil(std::hypot(coarse_width, coarse_height)), 0);
+        }
+
+        return bytes;
+    }
+
+    template <class Stats>
+    void BasicContext<Stats>::reset(const vImage_Buffer *image, const edge_list *edges, point_t origin) {
+        if (edges) {
+            scoreboard.reset(image, *edges, origin);
+        }
+        else {
+            scoreboard.reset(image, origin);
+        }
+    }
+
+    template <class Stats>
+    void BasicContext<Stats>::prepare_coarse(const vImage_Buffer *image, const edge_list *edges, point_t origin) {
+        trace::span span { "downsample" };
+
+        // Downsample with a maximum filter so that thin lines survive.
+
+        const managed_buffer<uint8_t> &dst = *coarse_image;
+
+        for (vImagePixelCount y = 0; y < dst.height; ++y) {
+            uint8_t * const row = dst[y];
+
+            std::fill_n(row, dst.width, 0);
+
+            const vImagePixelCount y_end = std::min<vImagePixelCount>((y + 1) * scale, image->height);
+
+            for (vImagePixelCount sy = y * scale; sy < y_end; ++sy) {
+                const uint8_t * const src = static_cast<const uint8_t *>(image->data) + image->rowBytes * sy;
+
+                for (vImagePixelCount sx = 0; sx < image->width; ++sx) {
+                    uint8_t &cell = row[sx / scale];
+                    if (cell < src[sx]) cell = src[sx];
+                }
+            }
+        }
+
+        coarse->reset(coarse_image.get());
+
+        // The full-resolution scoreboard only supplies the status map
+        // for refinement; no votes are cast on it.
+
+        reset(image, edges, origin);
+    }
+
+    template <class Stats>
+    void BasicContext<Stats>::refine(const segment_t &hint, std::vector<segment_t> &segments) {
+        // Map the coarse segment onto the centers of the corresponding
+        // full-resolution pixels.
+
+        const double offset = (scale - 1) / 2.0;
+
+        segment_t scaled = hint * static_cast<double>(scale);
+        scaled += offset;
+
+        scaled.lo += scoreboard.origin();
+        scaled.hi += scoreboard.origin();
+
+        scoreboard.refine(scaled, scale, segments);
+    }
+
+    template <class Stats>
+    void BasicContext<Stats>::claim_coarse(const std::vector<segment_t> &segments) {
+        // Commit the same lines on the coarse image, so that its votes
+        // are not spent finding them again.  The coarse segments are
+        // redundant.
+
+        const double offset = (scale - 1) / 2.0;
+
+        std::vector<segment_t> redundant;
+
+        for (segment_t segment : segments) {
+            segment.lo -= scoreboard.origin();
+            segment.hi -= scoreboard.origin();
+            segment -= offset;
+            segment /= static_cast<double>(scale);
+
+            coarse->refine(segment, 1, redundant);
+        }
+    }
+
+    template <class Stats>
+    std::vector<segment_t> BasicContext<Stats>::find_segments(const vImage_Buffer *image, const edge_list *edges, point_t origin) {
+        std::vector<segment_t> segments;
+
+        stats.clear();
+
+        generate(image, edges, origin, [&segments] (const segment_t &segment) {
+            segments.push_back(segment);
+            return true;
+        });
+
+        stats.add(&RunStats::raw_segments, segments.size());
+
+        {
+            typename Stats::scoped_timer timer { stats, &RunStats::postprocess_time };
+            trace::span span { "postprocess" };
+
+            if (single_precision(image, origin)) {
+                postprocess_in<float>(segments);
+            }
+            else {
+                postprocess_in<double>(segments);
+            }
+        }
+
+        stats.add(&RunStats::segments, segments.size());
+
+        return segments;
+    }
+
+    template <class Stats>
+    std::vector<Region> BasicContext<Stats>::find_regions(const vImage_Buffer *image, const edge_list *edges, point_t origin) {
+        auto segments = find_segments(image, edges, origin);
+
+        std::vector<Region> regions;
+
+        typename Stats::scoped_timer timer { stats, &RunStats::region_time };
+
+        if (single_precision(image, origin)) {
+            stats.add(&RunStats::corners, find_sorted_regions<float>(segments, regions, param.maxGap));
+        }
+        else {
+            stats.add(&RunStats::corners, find_sorted_regions<double>(segments, regions, param.maxGap));
+        }
+
+        return regions;
+    }
+
+    template class BasicContext<NullStats>;
+    template class BasicContext<CollectStats>;
+}
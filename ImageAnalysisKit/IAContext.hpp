@@ -0,0 +1,312 @@
+//
+//  IAContext.hpp
+//  ImageAnalysisKit
+//
+//  Created by Rob Menke on 10/18/26.
+//  Copyright © 2026 Rob Menke. All rights reserved.
+//
+
+#ifndef IAContext_hpp
+#define IAContext_hpp
+
+#include "IABase.hpp"
+#include "IAPolyline.hpp"
+#include "IAPostprocess.hpp"
+#include "IAScoreboard.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <memory>
+#include <vector>
+
+namespace IA {
+    /*!
+     * @abstract A reusable analysis context.
+     *
+     * @discussion A context holds the parsed parameters and the
+     *   scoreboard buffers for images of a single size.  Pages of a
+     *   book are almost always the same size, so analyzing them
+     *   through one context avoids reparsing the parameters and
+     *   reallocating and clearing the accumulator for every page.
+     *
+     *   A context is not thread-safe; use one context per thread.
+     *
+     * @tparam Stats The statistics policy; see @c BasicScoreboard.
+     */
+    template <class Stats>
+    class BasicContext {
+        const UserParameters param;
+        BasicScoreboard<Stats> scoreboard;
+
+        // Coarse-to-fine mode: segments are found on a copy of the
+        // image downsampled by @c scale, then each is refined within
+        // its channel on the full-resolution image.
+
+        const unsigned scale;
+        std::unique_ptr<managed_buffer<uint8_t>> coarse_image;
+        std::unique_ptr<BasicScoreboard<Stats>> coarse;
+
+        // The segments of a previous image, sought before any votes
+        // are cast; see set_hints.
+
+        std::vector<segment_t> hints;
+
+        // The counters for the work done outside the scoreboards.
+
+        Stats stats;
+
+        void reset(const vImage_Buffer *image, const edge_list *edges, point_t origin);
+        void prepare_coarse(const vImage_Buffer *image, const edge_list *edges, point_t origin);
+        void refine(const segment_t &hint, std::vector<segment_t> &segments);
+        void claim_coarse(const std::vector<segment_t> &segments);
+
+        /*!
+         * @abstract Whether the geometry of an image's segments is
+         *   carried out in single precision.
+         */
+        bool single_precision(const vImage_Buffer *image, point_t origin) const {
+            return !param.doubleGeometry && single_precision_suffices(std::max(origin.x + image->width, origin.y + image->height));
+        }
+
+        /*!
+         * @abstract Commit the segments along the hints and pass each
+         *   to a function.
+         * @return @c false if the function stopped the analysis.
+         */
+        template <class Function>
+        bool follow_hints(Function &function) {
+            trace::span span { "hints" };
+
+            const auto radius = static_cast<unsigned short>(std::min(std::max(param.hintRadius, 0), static_cast<int>(USHRT_MAX)));
+
+            std::vector<segment_t> found;
+
+            for (const auto &hint : hints) {
+                found.clear();
+                scoreboard.refine(hint, radius, found);
+
+                if (coarse) claim_coarse(found);
+
+                for (const auto &segment : found) {
+                    if (!function(segment)) return false;
+                }
+            }
+
+            return true;
+        }
+
+        /*!
+         * @abstract Pass each raw segment of an image to a function.
+         * @param edges The edge pixels of the image, or @c NULL to
+         *   find them.
+         * @return @c false if the function stopped the analysis.
+         */
+        template <class Function>
+        bool generate(const vImage_Buffer *image, const edge_list *edges, point_t origin, Function function) {
+            if (!coarse) {
+                reset(image, edges, origin);
+
+                if (!follow_hints(function)) return false;
+
+                for (const auto &segment : scoreboard) {
+                    if (!function(segment)) return false;
+                }
+
+                return true;
+            }
+
+            prepare_coarse(image, edges, origin);
+
+            if (!follow_hints(function)) return false;
+
+            std::vector<segment_t> refined;
+
+            for (const auto &hint : *coarse) {
+                refined.clear();
+                refine(hint, refined);
+
+                for (const auto &segment : refined) {
+                    if (!function(segment)) return false;
+                }
+            }
+
+            return true;
+        }
+
+    public:
+        /*!
+         * @param resolution The resolution of the full-resolution
+         *   accumulator; see @c BasicScoreboard.  The coarse
+         *   accumulator always chooses its own.
+         */
+        BasicContext(vImagePixelCount height, vImagePixelCount width, const UserParameters &param, Resolution resolution = Resolution { });
+
+        /*!
+         * @abstract Estimate the memory held by a context.
+         * @return An upper bound on the number of bytes.
+         */
+        static std::size_t footprint(vImagePixelCount height, vImagePixelCount width, const UserParameters &param, Resolution resolution = Resolution { });
+
+        BasicContext(const BasicContext &) = delete;
+        BasicContext &operator =(const BasicContext &) = delete;
+
+        const UserParameters &parameters() const {
+            return param;
+        }
+
+        /*!
+         * @abstract Let a monitor observe and cancel the analysis.
+         * @see BasicScoreboard::set_monitor
+         */
+        void set_monitor(const Monitor *monitor) {
+            scoreboard.set_monitor(monitor);
+            if (coarse) coarse->set_monitor(monitor);
+        }
+
+        /*!
+         * @abstract Start each analysis from the segments of a similar
+         *   image.
+         * @discussion Consecutive pages of a book, or frames of a
+         *   scanned strip, usually share a panel grid.  Before any
+         *   votes are cast, the line along each hint is sought within
+         *   @c hintRadius pixels of it and its segments are committed
+         *   and reported, exactly as if they had been found by voting
+         *   (see @c BasicScoreboard::refine).  Their pixels are then
+         *   never drawn, so when the hints match the image most of
+         *   the voting is skipped.  Lines absent from the hints are
+         *   found by voting as usual, and hints matching nothing cost
+         *   only the scan of their channels.
+         *
+         *   The hints apply to every later analysis until replaced.
+         * @param hints Segments in the coordinates of the images to be
+         *   analyzed (including any origin), typically the result of
+         *   @c find_segments on the previous image; empty to analyze
+         *   from scratch.
+         */
+        void set_hints(std::vector<segment_t> hints) {
+            this->hints = std::move(hints);
+        }
+
+        /*!
+         * @abstract Whether the last analysis stopped at one of the
+         *   limits set in the parameters before it was complete.
+         */
+        bool partial() const {
+            return coarse ? coarse->partial() : scoreboard.partial();
+        }
+
+        /*!
+         * @abstract The counters recorded during the last analysis.
+         * @discussion Always zero under the @c NullStats policy.
+         */
+        RunStats statistics() const {
+            RunStats result = scoreboard.statistics();
+
+            if (coarse) result += coarse->statistics();
+            result += stats.get();
+
+            return result;
+        }
+
+        /*!
+         * @abstract Find the line segments in an image.
+         * @param image The image to analyze, in Planar8 format.  It
+         *   must have the dimensions given when the context was
+         *   created.
+         * @param origin If @p image is a view of a region of a larger
+         *   buffer, the position of the region; the segments are
+         *   returned in the coordinates of the larger buffer.
+         * @return The segments after postprocessing.
+         */
+        std::vector<segment_t> find_segments(const vImage_Buffer *image, point_t origin = point_t { 0, 0 }) {
+            return find_segments(image, nullptr, origin);
+        }
+
+        /*!
+         * @abstract Find the line segments in an image whose edge
+         *   pixels are already known.
+         * @discussion Skips the scan of the image for edge pixels, so
+         *   that contexts analyzing one image with different
+         *   parameters can share a single scan.
+         * @param edges The edge pixels of @p image, as returned by @c
+         *   find_edges, or @c NULL to find them.
+         * @see find_segments
+         */
+        std::vector<segment_t> find_segments(const vImage_Buffer *image, const edge_list *edges, point_t origin = point_t { 0, 0 });
+
+        /*!
+         * @abstract Find the convex regions in an image.
+         * @param image The image to analyze, in Planar8 format.  It
+         *   must have the dimensions given when the context was
+         *   created.
+         * @param origin If @p image is a view of a region of a larger
+         *   buffer, the position of the region; the regions are
+         *   returned in the coordinates of the larger buffer.
+         * @return The regions in reading order.
+         */
+        std::vector<Region> find_regions(const vImage_Buffer *image, point_t origin = point_t { 0, 0 }) {
+            return find_regions(image, nullptr, origin);
+        }
+
+        /*!
+         * @abstract Find the convex regions in an image whose edge
+         *   pixels are already known.
+         * @see find_segments
+         */
+        std::vector<Region> find_regions(const vImage_Buffer *image, const edge_list *edges, point_t origin = point_t { 0, 0 });
+
+        /*!
+         * @abstract Deliver the line segments of an image as they are
+         *   found.
+         *
+         * @discussion Each segment is passed to the function as soon
+         *   as the scoreboard commits it, so a caller that only needs
+         *   the first few segments does not pay for the analysis of
+         *   the whole image.
+         *
+         *   If @p fused is true, each segment is fused with the
+         *   segments already delivered (see @c fuse_into) and the
+         *   function receives the index and new extent of the segment
+         *   that absorbed it.  A repeated index means that a segment
+         *   delivered earlier has grown.  Otherwise the indices are
+         *   consecutive and the segments are raw.
+         *
+         * @param image The image to analyze, in Planar8 format.
+         *
+         * @param fused Whether to fuse the segments as they arrive.
+         *
+         * @param function A function taking a @c std::size_t index
+         *   and a @c segment_t, and returning @c false to stop the
+         *   analysis.
+         *
+         * @return @c false if the function stopped the analysis.
+         */
+        template <class Function>
+        bool enumerate_segments(const vImage_Buffer *image, bool fused, Function function) {
+            std::vector<segment_t> segments;
+
+            stats.clear();
+
+            return generate(image, nullptr, point_t { 0, 0 }, [&] (const segment_t &segment) {
+                std::size_t index;
+
+                if (fused) {
+                    index = fuse_into(segments, segment);
+                }
+                else {
+                    index = segments.size();
+                    segments.push_back(segment);
+                }
+
+                return function(index, segments[index]);
+            });
+        }
+    };
+
+    using Context = BasicContext<NullStats>;
+
+    extern template class BasicContext<NullStats>;
+    extern template class BasicContext<CollectStats>;
+}
+
+#endif /* IAContext_hpp */
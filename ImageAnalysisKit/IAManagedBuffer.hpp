@@ -46,6 +46,35 @@ namespace IA {
             return reinterpret_cast<Pixel *>(static_cast<uint8_t *>(data) + rowBytes * y);
         }
     };
+
+    /*!
+     * @abstract Create a view of a rectangular region of a buffer.
+     * @discussion The view shares the pixels of the buffer; nothing
+     *   is copied.  It remains valid only as long as the buffer does.
+     * @tparam Pixel The pixel type of the buffer.
+     * @param buffer The buffer.
+     * @param x The left edge of the region.
+     * @param y The top edge of the region.
+     * @param width The width of the region.
+     * @param height The height of the region.
+     * @throw VImageException If the region is not contained in the
+     *   buffer.
+     */
+    template <class Pixel = uint8_t>
+    vImage_Buffer make_roi(const vImage_Buffer &buffer, vImagePixelCount x, vImagePixelCount y, vImagePixelCount width, vImagePixelCount height) {
+        if (x + width > buffer.width || y + height > buffer.height) {
+            throw VImageException(kvImageRoiLargerThanInputBuffer);
+        }
+
+        vImage_Buffer roi;
+
+        roi.data     = static_cast<uint8_t *>(buffer.data) + buffer.rowBytes * y + sizeof(Pixel) * x;
+        roi.height   = height;
+        roi.width    = width;
+        roi.rowBytes = buffer.rowBytes;
+
+        return roi;
+    }
 }
 
 #endif /* IAManagedBuffer_hpp */
@@ -0,0 +1,144 @@
+//
+//  IAMappedBuffer.cpp
+//  ImageAnalysisKit
+//
+//  Created by Rob Menke on 10/18/26.
+//  Copyright © 2026 Rob Menke. All rights reserved.
+//
+
+#include "IAMappedBuffer.hpp"
+#include "IATrace.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <cerrno>
+#include <system_error>
+
+namespace IA {
+    void mapped_buffer::map(const char *path) {
+        const int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) throw std::system_error(errno, std::generic_category(), path);
+
+        struct stat st;
+
+        if (fstat(fd, &st) < 0) {
+            const int code = errno;
+            close(fd);
+            throw std::system_error(code, std::generic_category(), path);
+        }
+
+        length = st.st_size;
+
+        if (length == 0) {
+            close(fd);
+            throw VImageException(kvImageBufferSizeMismatch);
+        }
+
+        mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        const int code = errno;
+        close(fd);
+
+        if (mapping == MAP_FAILED) {
+            mapping = nullptr;
+            throw std::system_error(code, std::generic_category(), path);
+        }
+
+        // The analysis reads every pixel once while queueing edges,
+        // then revisits them at random.
+
+        madvise(mapping, length, MADV_WILLNEED);
+    }
+
+    void mapped_buffer::set_geometry(vImagePixelCount width, vImagePixelCount height, std::size_t row_bytes, std::size_t offset) {
+        if (row_bytes == 0) row_bytes = width;
+
+        if (width == 0 || height == 0 || row_bytes < width) {
+            throw VImageException(kvImageInvalidParameter);
+        }
+
+        // The last row need only be as long as the image is wide.
+
+        if (offset > length || length - offset < width || (length - offset - width) / row_bytes < height - 1) {
+            throw VImageException(kvImageBufferSizeMismatch);
+        }
+
+        this->data     = static_cast<uint8_t *>(mapping) + offset;
+        this->width    = width;
+        this->height   = height;
+        this->rowBytes = row_bytes;
+    }
+
+    mapped_buffer::mapped_buffer(const char *path) {
+        trace::span span { "map_pgm" };
+
+        map(path);
+
+        try {
+            const auto bytes = static_cast<const uint8_t *>(mapping);
+
+            if (length < 2 || bytes[0] != 'P' || bytes[1] != '5') {
+                throw VImageException(kvImageInvalidImageFormat);
+            }
+
+            std::size_t pos = 2;
+            std::size_t fields[3];
+
+            for (auto &field : fields) {
+                // Skip whitespace and comments.
+
+                while (pos < length && (std::isspace(bytes[pos]) || bytes[pos] == '#')) {
+                    if (bytes[pos] == '#') {
+                        while (pos < length && bytes[pos] != '\n') ++pos;
+                    }
+                    else {
+                        ++pos;
+                    }
+                }
+
+                if (pos >= length || !std::isdigit(bytes[pos])) {
+                    throw VImageException(kvImageInvalidImageFormat);
+                }
+
+                field = 0;
+
+                while (pos < length && std::isdigit(bytes[pos]) && field <= UINT32_MAX) {
+                    field = field * 10 + (bytes[pos++] - '0');
+                }
+            }
+
+            // Exactly one whitespace character separates the header
+            // from the pixels.
+
+            if (pos >= length || !std::isspace(bytes[pos]) || fields[2] == 0 || fields[2] > 255) {
+                throw VImageException(kvImageInvalidImageFormat);
+            }
+
+            set_geometry(fields[0], fields[1], 0, pos + 1);
+        }
+        catch (...) {
+            munmap(mapping, length);
+            throw;
+        }
+    }
+
+    mapped_buffer::mapped_buffer(const char *path, vImagePixelCount width, vImagePixelCount height, std::size_t row_bytes, std::size_t offset) {
+        map(path);
+
+        try {
+            set_geometry(width, height, row_bytes, offset);
+        }
+        catch (...) {
+            munmap(mapping, length);
+            throw;
+        }
+    }
+
+    mapped_buffer::~mapped_buffer() {
+        munmap(mapping, length);
+    }
+}
@@ -0,0 +1,78 @@
+//
+//  IAMappedBuffer.hpp
+//  ImageAnalysisKit
+//
+//  Created by Rob Menke on 10/18/26.
+//  Copyright © 2026 Rob Menke. All rights reserved.
+//
+
+#ifndef IAMappedBuffer_hpp
+#define IAMappedBuffer_hpp
+
+#include "IAManagedBuffer.hpp"
+
+#include <cstddef>
+
+namespace IA {
+    /*!
+     * @abstract A read-only Planar8 buffer whose pixels are those of a
+     *   memory-mapped file.
+     *
+     * @discussion Nothing is decoded or copied: the buffer's data
+     *   points into the mapping, so the file's pages are read only as
+     *   the analysis touches them and are shared with the file cache.
+     *   The pixels must not be written; the mapping is read-only and
+     *   any write faults.
+     *
+     *   The file must not be truncated while it is mapped.
+     */
+    struct mapped_buffer : vImage_Buffer {
+        /*!
+         * @abstract Map a binary (P5) PGM file.
+         * @discussion Only eight-bit files (a maximum value below 256)
+         *   can be viewed without conversion.
+         * @throw std::system_error If the file cannot be opened or
+         *   mapped.
+         * @throw VImageException With @c kvImageInvalidImageFormat if
+         *   the file is not an eight-bit binary PGM file.
+         */
+        explicit mapped_buffer(const char *path);
+
+        /*!
+         * @abstract Map a file of raw Planar8 pixels.
+         * @param path The file.
+         * @param width The width of the image.
+         * @param height The height of the image.
+         * @param row_bytes The distance between the starts of rows, or
+         *   0 if the rows are packed.
+         * @param offset The position of the first pixel in the file,
+         *   e.g., the size of a header.
+         * @throw std::system_error If the file cannot be opened or
+         *   mapped.
+         * @throw VImageException With @c kvImageBufferSizeMismatch if
+         *   the file is too short for the geometry.
+         */
+        mapped_buffer(const char *path, vImagePixelCount width, vImagePixelCount height, std::size_t row_bytes = 0, std::size_t offset = 0);
+
+        mapped_buffer(const mapped_buffer &r) = delete;
+        mapped_buffer(mapped_buffer &&r) = delete;
+
+        mapped_buffer &operator =(const mapped_buffer &r) = delete;
+        mapped_buffer &operator =(mapped_buffer &&r) = delete;
+
+        ~mapped_buffer();
+
+        const uint8_t *operator [](vImagePixelCount y) const {
+            return static_cast<const uint8_t *>(data) + rowBytes * y;
+        }
+
+    private:
+        void *mapping = nullptr;
+        std::size_t length = 0;
+
+        void map(const char *path);
+        void set_geometry(vImagePixelCount width, vImagePixelCount height, std::size_t row_bytes, std::size_t offset);
+    };
+}
+
+#endif /* IAMappedBuffer_hpp */
@@ -0,0 +1,94 @@
+//
+//  IAMonitor.hpp
+//  ImageAnalysisKit
+//
+//  Created by Rob Menke on 10/18/26.
+//  Copyright © 2026 Rob Menke. All rights reserved.
+//
+
+#ifndef IAMonitor_hpp
+#define IAMonitor_hpp
+
+#include <atomic>
+#include <cerrno>
+#include <system_error>
+
+namespace IA {
+    /*!
+     * @abstract Observe and cancel an analysis from another thread.
+     *
+     * @discussion A scoreboard given a monitor checks it before every
+     *   vote, and reports the fraction of its queue consumed every few
+     *   hundred votes.  A tiled context divides the range of progress
+     *   among its tiles, so the fraction reported covers the whole
+     *   image.
+     *
+     *   Only @c cancel may be called from a thread other than the one
+     *   running the analysis.
+     */
+    class Monitor {
+    public:
+        using callback_t = void (*)(double fraction, void *info);
+
+    private:
+        std::atomic<bool> cancelled { false };
+
+        const callback_t callback;
+        void * const info;
+
+        // The part of the whole analysis covered by the current
+        // scoreboard.
+
+        double base = 0, span = 1;
+
+    public:
+        /*!
+         * @param callback A function called on the analyzing thread
+         *   with the fraction of the analysis done, or @c nullptr.
+         * @param info A pointer passed to the callback.
+         */
+        Monitor(callback_t callback = nullptr, void *info = nullptr) : callback(callback), info(info) { }
+
+        Monitor(const Monitor &) = delete;
+        Monitor &operator =(const Monitor &) = delete;
+
+        /*!
+         * @abstract Ask the analysis to stop at the next vote.
+         */
+        void cancel() {
+            cancelled.store(true, std::memory_order_relaxed);
+        }
+
+        bool is_cancelled() const {
+            return cancelled.load(std::memory_order_relaxed);
+        }
+
+        /*!
+         * @abstract Stop the analysis if it has been cancelled.
+         * @throw std::system_error With @c ECANCELED.
+         */
+        void check() const {
+            if (is_cancelled()) throw std::system_error(ECANCELED, std::generic_category(), "analysis cancelled");
+        }
+
+        /*!
+         * @abstract Report the progress of the current part of the
+         *   analysis.
+         * @param fraction The fraction of the current part done.
+         */
+        void report(double fraction) const {
+            if (callback) callback(base + span * fraction, info);
+        }
+
+        /*!
+         * @abstract Set the part of the analysis whose progress @c
+         *   report receives.
+         */
+        void set_range(double base, double span) {
+            this->base = base;
+            this->span = span;
+        }
+    };
+}
+
+#endif /* IAMonitor_hpp */
@@ -12,37 +12,49 @@
 #include "IABase.hpp"
 #include "IAManagedBuffer.hpp"
 
+#include <cstdint>
+#include <utility>
 #include <vector>
 
 namespace IA {
+    /*!
+     * @abstract A candidate segment found by a channel scan.
+     *
+     * @discussion A pixel may belong to only one candidate of a scan.
+     *   Rather than changing the status of the pixels it claims, which
+     *   would have to be undone for every candidate not chosen, a
+     *   point set tags them in a separate plane with the epoch of its
+     *   scan.  Each scan has a new epoch, so the tags of earlier scans
+     *   lapse without a pass over their pixels, and discarding a
+     *   candidate costs nothing.
+     *
+     *   Points are stored as 16-bit coordinates, which the scoreboard
+     *   guarantees are enough.
+     */
     class PointSet {
+    public:
+        using epoch_t = uint16_t;
+
+    private:
+        using coord_pair = std::pair<uint16_t, uint16_t>;
+
         segment_t segment;
 
         const managed_buffer<status_t> &buffer;
-        std::vector<std::pair<long, long>> points;
+        const managed_buffer<epoch_t> &marks;
+        epoch_t epoch;
+
+        std::vector<coord_pair> points;
 
         bool valid = false;
 
     public:
-        PointSet(const managed_buffer<status_t> &buffer) : buffer(buffer) { }
+        PointSet(const managed_buffer<status_t> &buffer, const managed_buffer<epoch_t> &marks, epoch_t epoch) : buffer(buffer), marks(marks), epoch(epoch) { }
         PointSet(const PointSet &) = delete;
-        PointSet(PointSet &&r) : segment(r.segment), buffer(r.buffer), points(std::move(r.points)), valid(r.valid) {
+        PointSet(PointSet &&r) : segment(r.segment), buffer(r.buffer), marks(r.marks), epoch(r.epoch), points(std::move(r.points)), valid(r.valid) {
             r.valid = false;
         }
 
-        ~PointSet() {
-            for (const auto &p : points) {
-                auto &cell = buffer[p.second][p.first];
-
-                if (cell == status_t::marked_pending) {
-                    cell = status_t::pending;
-                }
-                else if (cell == status_t::marked_voted) {
-                    cell = status_t::voted;
-                }
-            }
-        }
-
         PointSet &operator =(const PointSet &) = delete;
         PointSet &operator =(PointSet &&r) = delete;
 
@@ -78,22 +90,23 @@ namespace IA {
             if (x < 0 || x >= buffer.width) return false;
             if (y < 0 || y >= buffer.height) return false;
 
-            auto &cell = buffer[y][x];
+            const status_t cell = buffer[y][x];
+            if (cell != status_t::pending && cell != status_t::voted) return false;
 
-            if (cell == status_t::pending) {
-                points.emplace_back(x, y);
-                cell = status_t::marked_pending;
-                return true;
-            }
-            if (cell == status_t::voted) {
-                points.emplace_back(x, y);
-                cell = status_t::marked_voted;
-                return true;
-            }
+            epoch_t &mark = marks[y][x];
+            if (mark == epoch) return false;
 
-            return false;
+            mark = epoch;
+            points.emplace_back(static_cast<uint16_t>(x), static_cast<uint16_t>(y));
+
+            return true;
         }
 
+        /*!
+         * @abstract Claim the points for a segment.
+         * @discussion Afterward only the points that had voted remain,
+         *   so that their votes can be withdrawn.
+         */
         void commit() {
             auto begin = points.begin();
             auto end   = points.end();
@@ -101,14 +114,14 @@ namespace IA {
             while (begin != end) {
                 auto &cell = buffer[begin->second][begin->first];
 
-                if (cell == status_t::marked_pending) {
-                    cell = status_t::done;
-                    *begin = *(--end);
-                }
-                else if (cell == status_t::marked_voted) {
+                if (cell == status_t::voted) {
                     cell = status_t::done;
                     ++begin;
                 }
+                else {
+                    if (cell == status_t::pending) cell = status_t::done;
+                    *begin = *(--end);
+                }
             }
 
             points.erase(end, points.end());
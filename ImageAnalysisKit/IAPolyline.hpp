@@ -10,8 +10,10 @@
 #define IAPolyline_hpp
 
 #include "IABase.hpp"
+#include "IATrace.hpp"
 
 #include <deque>
+#include <iterator>
 #include <vector>
 
 namespace IA {
@@ -23,7 +25,8 @@ namespace IA {
      *
      * @return The intersection point of the lines coinciding with the segments.  If the segments are parallel, this solution will contain Infinity.
      */
-    static inline point_t intersection(const segment_t &s1, const segment_t &s2) {
+    template <class Segment>
+    static inline typename segment_geometry<Segment>::point intersection(const Segment &s1, const Segment &s2) {
         const auto t = (s1.hi - s1.lo);
         const auto u = (s2.hi - s2.lo);
 
@@ -42,7 +45,10 @@ namespace IA {
         return (p - q) / (v.y - v.x);
     }
 
-    class Corner {
+    template <class Segment>
+    class BasicCorner {
+        using point = typename segment_geometry<Segment>::point;
+
         /*!
          * Returns the point on the segment that is farthest from the given point.
          *
@@ -50,28 +56,37 @@ namespace IA {
          * @param s The segment.
          * @return The endpoint of @c s that is farthest from @c p.
          */
-        static point_t farthest(point_t p, segment_t s) {
+        static point farthest(point p, Segment s) {
             const auto d1 = simd::distance_squared(p, s.lo);
             const auto d2 = simd::distance_squared(p, s.hi);
             return d1 > d2 ? s.lo : s.hi;
         }
 
     public:
-        const segment_t *s1, *s2;
-        point_t a, b, c;
+        using segment_type = Segment;
+
+        const Segment *s1, *s2;
+        point a, b, c;
 
-        Corner(const segment_t *s1, point_t p, const segment_t *s2) : s1(s1), s2(s2), a(farthest(p, *s1)), b(p), c(farthest(p, *s2)) { }
+        BasicCorner(const Segment *s1, point p, const Segment *s2) : s1(s1), s2(s2), a(farthest(p, *s1)), b(p), c(farthest(p, *s2)) { }
 
-        bool operator ==(const Corner &rhs) const {
+        bool operator ==(const BasicCorner &rhs) const {
             return s1 == rhs.s1 && s2 == rhs.s2;
         }
 
-        bool operator !=(const Corner &rhs) const {
+        bool operator !=(const BasicCorner &rhs) const {
             return !operator ==(rhs);
         }
     };
 
-    using Region = simd::double4;
+    using Corner = BasicCorner<segment_t>;
+
+    /*!
+     * @abstract A region: x, y, width, height.
+     */
+    template <class Scalar> using BasicRegion = basic_segment_t<Scalar>;
+
+    using Region = BasicRegion<double>;
 
     static inline Region make_region(point_t min, point_t max) {
         Region region;
@@ -82,9 +97,20 @@ namespace IA {
         return region;
     }
 
+    /*!
+     * @abstract Find the corners between pairs of segments.
+     * @discussion The arithmetic is carried out in the precision of
+     *   the segments, and the corners are @c BasicCorner objects of
+     *   the same segment type.
+     */
     template <class FwdIterator, class OutputIterator>
     void find_corners(FwdIterator _begin, FwdIterator _end, OutputIterator _out, double max_gap) {
-        const double max_gap_squared = max_gap * max_gap;
+        using segment     = typename std::iterator_traits<FwdIterator>::value_type;
+        using point       = typename segment_geometry<segment>::point;
+        using scalar      = typename segment_geometry<segment>::scalar;
+        using corner_type = BasicCorner<segment>;
+
+        const scalar max_gap_squared = max_gap * max_gap;
 
         for (auto i = _begin; i != _end; ++i) {
             auto &s1 = *i;
@@ -94,10 +120,10 @@ namespace IA {
 
                 const auto p = intersection(s1, s2);
 
-                point_t a, b;
+                point a, b;
 
-                double d1 = simd::distance_squared(p, s1.lo);
-                double d2 = simd::distance_squared(p, s1.hi);
+                scalar d1 = simd::distance_squared(p, s1.lo);
+                scalar d2 = simd::distance_squared(p, s1.hi);
 
                 if (d1 < d2) {
                     if (d1 > max_gap_squared) continue;
@@ -123,7 +149,7 @@ namespace IA {
                 // Determine the orientation of the corner by examining the cross product of the two vectors relative to their intersection.  If the sine is not positive, reverse the ordering.
                 const auto sine_between = simd::cross(b - p, a - p).z;
 
-                *_out = (sine_between > 0.0) ? Corner(&s1, p, &s2) : Corner(&s2, p, &s1);
+                *_out = (sine_between > 0) ? corner_type(&s1, p, &s2) : corner_type(&s2, p, &s1);
                 ++_out;
             }
         }
@@ -133,13 +159,16 @@ namespace IA {
     FwdIterator find_next_region(FwdIterator _begin, FwdIterator _end, OutputIterator _out) {
         using namespace std;
 
+        using corner_type = typename iterator_traits<FwdIterator>::value_type;
+        using region_type = typename corner_type::segment_type;
+
         if (_begin == _end) return _end;
 
         swap(*_begin, *(--_end));
 
         // A polyline is a sequence of Corner objects such that for all 0 < n < polyline.size(), std::get<0>(polyline[n-1]) == std::get<2>(polyline[n]).  Assuming that the corners are oriented the same way, the polyline is convex.
 
-        deque<Corner> polyline;
+        deque<corner_type> polyline;
         polyline.push_back(*_end);
 
         // Prepend corners to head (convex polygon)
@@ -180,13 +209,13 @@ namespace IA {
         // If the polyline is not a polygon, then we need to include the initial and terminal points from the initial and terminal segments.
         const bool is_open = (polyline.front().s1 != polyline.back().s2);
 
-        Region r;
+        region_type r;
 
         if (is_open) {
             r.lo = r.hi = polyline.front().a;
         }
         else {
-            r = Region{+INFINITY, +INFINITY, -INFINITY, -INFINITY};
+            r = region_type{+INFINITY, +INFINITY, -INFINITY, -INFINITY};
         }
 
         for (const auto &corner : polyline) {
@@ -208,22 +237,37 @@ namespace IA {
         return _end;
     }
 
+    /*!
+     * @abstract Find the convex regions bounded by a collection of segments.
+     *
+     * @discussion The arithmetic is carried out in the precision of
+     *   the segments, and the regions have the same type.
+     *
+     * @return The number of corners found between the segments.
+     */
     template <class FwdIterator, class OutputIterator>
-    void find_regions(FwdIterator _begin, FwdIterator _end, OutputIterator _out, double max_gap) {
-        std::vector<Corner> corners;
+    std::size_t find_regions(FwdIterator _begin, FwdIterator _end, OutputIterator _out, double max_gap) {
+        std::vector<BasicCorner<typename std::iterator_traits<FwdIterator>::value_type>> corners;
 
-        find_corners(_begin, _end, std::back_inserter(corners), max_gap);
+        {
+            trace::span span { "find_corners" };
+            find_corners(_begin, _end, std::back_inserter(corners), max_gap);
+        }
 
         auto begin = corners.begin();
         auto end   = corners.end();
 
         while (begin != end) {
+            trace::span span { "find_next_region" };
             end = find_next_region(begin, end, _out);
         }
+
+        return corners.size();
     }
 
-    static inline double vertical_overlap(Region a, Region b) {
-        auto inter = simd::double2 {
+    template <class RegionType>
+    static inline auto vertical_overlap(RegionType a, RegionType b) {
+        auto inter = typename segment_geometry<RegionType>::point {
             std::max(a.s0, b.s0),
             std::min(a.s0 + a.s2, b.s0 + b.s2)
         };
@@ -233,9 +277,10 @@ namespace IA {
         return std::max(inter.s1 / a.s2, inter.s1 / b.s2);
     }
 
-    static inline bool region_earlier(Region r1, Region r2) {
-        const auto c1 = r1.lo + r1.hi / 2.0;
-        const auto c2 = r2.lo + r2.hi / 2.0;
+    template <class RegionType>
+    static inline bool region_earlier(RegionType r1, RegionType r2) {
+        const auto c1 = r1.lo + r1.hi / 2;
+        const auto c2 = r2.lo + r2.hi / 2;
 
         if (vertical_overlap(r1, r2) >= 0.8) {
             return c1.x < c2.x;
@@ -258,9 +303,11 @@ namespace IA {
      */
     template <class RandomAccessIterator>
     void sort_regions(RandomAccessIterator _begin, RandomAccessIterator _end) {
+        trace::span span { "sort_regions" };
+
         while (_begin != _end) {
             // Find the region nearest to the top edge. If there is more than one with the same distance, find the one nearest to the left edge.
-            auto min = std::min_element(_begin, _end, [] (Region a, Region b) {
+            auto min = std::min_element(_begin, _end, [] (const auto &a, const auto &b) {
                 if (a.y < b.y) return true;
                 if (a.y > b.y) return false;
                 return a.x < b.x;
@@ -269,19 +316,19 @@ namespace IA {
             std::swap(*_begin, *min);
 
             // Separate the remaining regions by those that vertically overlap the first region by 50% and those that do not overlap.
-            auto _mid = std::partition(_begin + 1, _end, [ry = _begin->y, rh = _begin->s3] (Region s) {
-                const double sy = s.y;
-                const double sh = s.s3;
+            auto _mid = std::partition(_begin + 1, _end, [ry = _begin->y, rh = _begin->s3] (const auto &s) {
+                const auto sy = s.y;
+                const auto sh = s.s3;
 
                 const auto min = std::max(ry, sy);
                 const auto max = std::min(ry + rh, sy + sh);
 
                 // (max - min) / rh is the fraction of vertical overlap between the two regions.  If this value is non-positive, there is no overlap.  Return true only if there is 50% or greater overlap.
-                return (max - min) >= (0.5 * rh);
+                return (max - min) >= (rh / 2);
             });
 
             // Everything in [_begin, _mid) belongs to the same logical row.  Sort them by their horizontal position first, then if there are any ties, by the vertical position.  This usually (but not always) produces the correct reading order.
-            std::sort(_begin, _mid, [] (Region a, Region b) {
+            std::sort(_begin, _mid, [] (const auto &a, const auto &b) {
                 if (a.x < b.x) return true;
                 if (a.x > b.x) return false;
                 return a.y < b.y;
@@ -290,6 +337,37 @@ namespace IA {
             _begin = _mid;
         }
     }
+
+    /*!
+     * @abstract Find the regions bounded by a collection of segments
+     *   and sort them in reading order, in the given precision.
+     * @discussion The segments are converted to the precision, and the
+     *   regions converted back.
+     * @tparam Scalar @c float or @c double.
+     * @return The number of corners found between the segments.
+     */
+    template <class Scalar>
+    std::size_t find_sorted_regions(const std::vector<segment_t> &segments, std::vector<Region> &regions, double max_gap) {
+        using G = geometry<Scalar>;
+
+        std::vector<typename G::segment> converted;
+        converted.reserve(segments.size());
+
+        for (const auto &segment : segments) {
+            converted.push_back(G::from_double(segment));
+        }
+
+        std::vector<typename G::segment> found;
+
+        const auto corners = find_regions(converted.begin(), converted.end(), std::back_inserter(found), max_gap);
+        sort_regions(found.begin(), found.end());
+
+        for (const auto &region : found) {
+            regions.push_back(G::to_double(region));
+        }
+
+        return corners;
+    }
 }
 
 #endif /* IAPolyline_hpp */
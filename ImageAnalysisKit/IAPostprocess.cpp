@@ -12,15 +12,21 @@ constexpr double channel_width = 3.0;
 constexpr double channel_radius = (channel_width - 1) / 2.0;
 
 namespace IA {
-    bool fuse(segment_t &s, const segment_t &t) {
+    template <class Segment>
+    bool fuse(Segment &s, const Segment &t) {
+        using G = segment_geometry<Segment>;
+        using scalar = typename G::scalar;
+
+        const scalar radius = channel_radius;
+
         // Step 1: Verify that t is in the same channel as s.
 
         const auto v = s.hi - s.lo;
-        const auto n = simd::normalize(simd::double2{-v.y, v.x});
+        const auto n = simd::normalize(typename G::point { -v.y, v.x });
         const auto r = simd::dot(n, s.lo);
 
-        const auto r_lo = r - channel_radius;
-        const auto r_hi = r + channel_radius;
+        const auto r_lo = r - radius;
+        const auto r_hi = r + radius;
 
         const auto r1 = simd::dot(n, t.lo);
         if (r1 < r_lo || r1 > r_hi) return false;
@@ -37,15 +43,18 @@ namespace IA {
 
         if (z0 > z1) std::swap(z0, z1);
 
-        if (z1 >= 0 && z0 <= 1.0) {
+        if (z1 >= 0 && z0 <= 1) {
             // Step 3: The projection overlaps.  Update s.
 
-            if (z1 > 1.0) s.hi = s.lo + v * z1;
-            if (z0 < 0.0) s.lo = s.lo + v * z0;
+            if (z1 > 1) s.hi = s.lo + v * z1;
+            if (z0 < 0) s.lo = s.lo + v * z0;
 
             return true;
         }
 
         return false;
     }
+
+    template bool fuse(simd::double4 &, const simd::double4 &);
+    template bool fuse(simd::float4 &, const simd::float4 &);
 }
@@ -11,8 +11,17 @@
 
 #include "IABase.hpp"
 
+#include <vector>
+
 namespace IA {
-    extern bool fuse(segment_t &s, const segment_t &t);
+    /*!
+     * @abstract Extend one segment by another lying in its channel.
+     * @discussion Instantiated for @c simd::double4 and @c
+     *   simd::float4.
+     * @return @c true if @p t was absorbed into @p s.
+     */
+    template <class Segment>
+    bool fuse(Segment &s, const Segment &t);
 
     template <class Iterator>
     Iterator postprocess(Iterator _first, Iterator _last) {
@@ -51,6 +60,73 @@ namespace IA {
 
         return _last;
     }
+
+    /*!
+     * @abstract Fuse a segment into a collection of segments as it
+     *   arrives.
+     *
+     * @discussion This is the incremental counterpart to @c
+     *   postprocess: the segment is fused with the first existing
+     *   segment that shares its channel, or appended if there is none.
+     *   Segments already in the collection are not fused with each
+     *   other, so the result may hold more segments than @c
+     *   postprocess would produce.
+     *
+     * @param segments The segments found so far.
+     *
+     * @param segment The new segment.
+     *
+     * @return The index of the segment that absorbed or received the
+     *   new segment.
+     */
+    template <class Segment>
+    std::size_t fuse_into(std::vector<Segment> &segments, const Segment &segment) {
+        for (std::size_t i = 0; i < segments.size(); ++i) {
+            if (fuse(segments[i], segment)) return i;
+
+            Segment t = segment;
+
+            if (fuse(t, segments[i])) {
+                segments[i] = t;
+                return i;
+            }
+        }
+
+        segments.push_back(segment);
+
+        return segments.size() - 1;
+    }
+
+    /*!
+     * @abstract Postprocess segments in the given precision.
+     * @discussion The segments are converted to the precision, fused,
+     *   and converted back.
+     * @tparam Scalar @c float or @c double.
+     */
+    template <class Scalar>
+    void postprocess_in(std::vector<segment_t> &segments) {
+        using G = geometry<Scalar>;
+
+        std::vector<typename G::segment> converted;
+        converted.reserve(segments.size());
+
+        for (const auto &segment : segments) {
+            converted.push_back(G::from_double(segment));
+        }
+
+        converted.erase(postprocess(converted.begin(), converted.end()), converted.end());
+
+        segments.clear();
+
+        for (const auto &segment : converted) {
+            segments.push_back(G::to_double(segment));
+        }
+    }
+
+    template <>
+    inline void postprocess_in<double>(std::vector<segment_t> &segments) {
+        segments.erase(postprocess(segments.begin(), segments.end()), segments.end());
+    }
 }
 
 #endif /* IAPostprocess_hpp */
@@ -0,0 +1,275 @@
+//
+//  IAResultCache.cpp
+//  ImageAnalysisKit
+//
+//  Created by Rob Menke on 10/18/26.
+//  Copyright © 2026 Rob Menke. All rights reserved.
+//
+
+#include "IAResultCache.hpp"
+#include "IATrace.hpp"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <system_error>
+
+namespace IA {
+    // Bumped whenever the analysis changes in a way that changes its
+    // results, so that stale files are never read.
+
+    static constexpr uint32_t format_version = 2;
+    static constexpr char magic[4] = { 'I', 'A', 'R', 'C' };
+    static constexpr char suffix[] = ".iar";
+
+    struct file_header {
+        char magic[4];
+        uint32_t version;
+        uint32_t kind;
+        uint32_t count;
+    };
+
+    /*!
+     * @abstract A fast 128-bit hash of a byte stream.
+     * @discussion Two independent 64-bit multiply-rotate lanes over
+     *   eight-byte words.  It is not cryptographic, but with 128 bits
+     *   accidental collisions between pages are not a concern.
+     */
+    class hasher {
+        static constexpr uint64_t k0 = 0x9e3779b97f4a7c15ULL;
+        static constexpr uint64_t k1 = 0xc2b2ae3d27d4eb4fULL;
+        static constexpr uint64_t k2 = 0x165667b19e3779f9ULL;
+
+        uint64_t a = k0, b = k1;
+        uint64_t length = 0;
+
+        static uint64_t rotl(uint64_t x, int r) {
+            return (x << r) | (x >> (64 - r));
+        }
+
+        void word(uint64_t k) {
+            a = rotl(a ^ (k * k1), 31) * k0;
+            b = rotl(b ^ (k * k2), 29) * k1;
+        }
+
+        static uint64_t fmix(uint64_t x) {
+            x ^= x >> 33;
+            x *= 0xff51afd7ed558ccdULL;
+            x ^= x >> 33;
+            x *= 0xc4ceb9fe1a85ec53ULL;
+            x ^= x >> 33;
+            return x;
+        }
+
+    public:
+        void add(const void *data, std::size_t n) {
+            auto bytes = static_cast<const uint8_t *>(data);
+
+            length += n;
+
+            for (; n >= 8; n -= 8, bytes += 8) {
+                uint64_t k;
+                memcpy(&k, bytes, 8);
+                word(k);
+            }
+
+            if (n) {
+                uint64_t k = 0;
+                memcpy(&k, bytes, n);
+                word(k ^ (static_cast<uint64_t>(n) << 56));
+            }
+        }
+
+        template <class T>
+        void add(const T &value) {
+            add(&value, sizeof(value));
+        }
+
+        std::string hex() const {
+            const uint64_t h0 = fmix(a ^ length) + b;
+            const uint64_t h1 = fmix(b ^ rotl(length, 32)) + h0;
+
+            char buffer[33];
+            snprintf(buffer, sizeof(buffer), "%016llx%016llx", static_cast<unsigned long long>(h0), static_cast<unsigned long long>(h1));
+
+            return buffer;
+        }
+    };
+
+    ResultCache::ResultCache(std::string directory, std::size_t capacity) : directory(std::move(directory)), capacity(capacity), size(0) {
+        if (mkdir(this->directory.c_str(), 0777) < 0 && errno != EEXIST) {
+            throw std::system_error(errno, std::generic_category(), this->directory);
+        }
+
+        if (capacity) size = evict();
+    }
+
+    std::string ResultCache::path_for(const vImage_Buffer *image, const UserParameters &param, kind k) const {
+        trace::span span { "cache_hash" };
+
+        hasher hash;
+
+        hash.add(format_version);
+        hash.add(k);
+        hash.add(image->width);
+        hash.add(image->height);
+
+        // Only the pixels count, not the row padding.
+
+        for (vImagePixelCount y = 0; y < image->height; ++y) {
+            hash.add(static_cast<const uint8_t *>(image->data) + image->rowBytes * y, image->width);
+        }
+
+#define HASH_PARAM(X,T) hash.add(param.X)
+#define HASH_OPTIONAL_PARAM(X,T,D) hash.add(param.X)
+        PARAMS(HASH_PARAM,;);
+        OPTIONAL_PARAMS(HASH_OPTIONAL_PARAM,;);
+#undef HASH_OPTIONAL_PARAM
+#undef HASH_PARAM
+
+        return directory + "/" + hash.hex() + suffix;
+    }
+
+    bool ResultCache::find(const vImage_Buffer *image, const UserParameters &param, kind k, std::vector<simd::double4> &result) const {
+        const auto path = path_for(image, param, k);
+
+        trace::span span { "cache_read" };
+
+        const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+
+        file_header header;
+        struct stat st;
+        bool found = false;
+
+        // The count is trusted only if the file holds exactly that
+        // many results, so a truncated or corrupt file is a miss
+        // rather than an enormous allocation.
+
+        if (read(fd, &header, sizeof(header)) == sizeof(header) && memcmp(header.magic, magic, sizeof(magic)) == 0 && header.version == format_version && header.kind == static_cast<uint32_t>(k) && fstat(fd, &st) == 0 && static_cast<uint64_t>(st.st_size) == sizeof(header) + static_cast<uint64_t>(header.count) * sizeof(simd::double4)) {
+            const auto bytes = header.count * sizeof(simd::double4);
+
+            result.resize(header.count);
+
+            found = read(fd, result.data(), bytes) == static_cast<ssize_t>(bytes);
+
+            // Mark the file as recently used.
+
+            if (found) futimes(fd, nullptr);
+        }
+
+        close(fd);
+
+        if (!found) result.clear();
+
+        return found;
+    }
+
+    void ResultCache::store(const vImage_Buffer *image, const UserParameters &param, kind k, const std::vector<simd::double4> &result) {
+        const auto path = path_for(image, param, k);
+
+        trace::span span { "cache_write" };
+
+        std::string temp = directory + "/.tmp.XXXXXX";
+
+        const int fd = mkstemp(&temp[0]);
+        if (fd < 0) return;
+
+        file_header header;
+        memcpy(header.magic, magic, sizeof(magic));
+        header.version = format_version;
+        header.kind    = static_cast<uint32_t>(k);
+        header.count   = static_cast<uint32_t>(result.size());
+
+        const auto bytes = result.size() * sizeof(simd::double4);
+
+        const bool written = write(fd, &header, sizeof(header)) == sizeof(header) && write(fd, result.data(), bytes) == static_cast<ssize_t>(bytes);
+
+        fchmod(fd, 0644);
+        close(fd);
+
+        if (!written || rename(temp.c_str(), path.c_str()) < 0) {
+            unlink(temp.c_str());
+            return;
+        }
+
+        if (capacity && (size += sizeof(header) + bytes) > capacity) {
+            size = evict();
+        }
+    }
+
+    std::size_t ResultCache::evict() {
+        trace::span span { "cache_evict" };
+
+        // Serialize eviction across processes.  Readers and writers do
+        // not take the lock; a file removed while it is being read
+        // stays readable until it is closed.
+
+        const auto lock_path = directory + "/.lock";
+
+        const int lock = open(lock_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (lock < 0) return 0;
+
+        flock(lock, LOCK_EX);
+
+        struct entry {
+            std::string path;
+            std::size_t size;
+            struct timespec mtime;
+        };
+
+        std::vector<entry> entries;
+        std::size_t total = 0;
+
+        if (DIR *dir = opendir(directory.c_str())) {
+            const std::size_t suffix_length = strlen(suffix);
+
+            while (struct dirent *e = readdir(dir)) {
+                const std::size_t length = strlen(e->d_name);
+
+                if (length <= suffix_length || strcmp(e->d_name + length - suffix_length, suffix) != 0) continue;
+
+                auto path = directory + "/" + e->d_name;
+
+                struct stat st;
+                if (stat(path.c_str(), &st) < 0) continue;
+
+                entries.push_back(entry { std::move(path), static_cast<std::size_t>(st.st_size), st.st_mtimespec });
+                total += st.st_size;
+            }
+
+            closedir(dir);
+        }
+
+        // Evict down to nine tenths of the capacity, so that eviction
+        // does not run again on the very next store.
+
+        if (total > capacity) {
+            std::sort(entries.begin(), entries.end(), [] (const entry &a, const entry &b) {
+                if (a.mtime.tv_sec != b.mtime.tv_sec) return a.mtime.tv_sec < b.mtime.tv_sec;
+                return a.mtime.tv_nsec < b.mtime.tv_nsec;
+            });
+
+            const std::size_t target = capacity / 10 * 9;
+
+            for (const auto &e : entries) {
+                if (total <= target) break;
+
+                if (unlink(e.path.c_str()) == 0) total -= e.size;
+            }
+        }
+
+        flock(lock, LOCK_UN);
+        close(lock);
+
+        return total;
+    }
+}
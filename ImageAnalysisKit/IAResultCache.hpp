@@ -0,0 +1,93 @@
+//
+//  IAResultCache.hpp
+//  ImageAnalysisKit
+//
+//  Created by Rob Menke on 10/18/26.
+//  Copyright © 2026 Rob Menke. All rights reserved.
+//
+
+#ifndef IAResultCache_hpp
+#define IAResultCache_hpp
+
+#include "IABase.hpp"
+#include "IAManagedBuffer.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace IA {
+    /*!
+     * @abstract A content-addressed cache of analysis results on disk.
+     *
+     * @discussion Each result is stored in its own file, named by a
+     *   128-bit hash of the image's pixels, its dimensions, every
+     *   parameter (including @c seed), and the kind of result.  An
+     *   unchanged page therefore finds its result with one hash and
+     *   one small read, however it was loaded.
+     *
+     *   Files are written to a temporary name and renamed into place,
+     *   so readers in any process see either nothing or a complete
+     *   file and need no locks.  Reading a file updates its
+     *   modification time, and when the directory grows past its
+     *   capacity the least recently used files are removed under an
+     *   exclusive @c flock, so processes sharing the directory do not
+     *   evict concurrently.
+     *
+     *   A cache is thread-safe.
+     */
+    class ResultCache {
+    public:
+        enum class kind : uint32_t {
+            segments = 'S',
+            regions  = 'R'
+        };
+
+    private:
+        const std::string directory;
+        const std::size_t capacity;
+
+        // An estimate of the size of the directory, corrected whenever
+        // the cache evicts.
+
+        std::atomic<std::size_t> size;
+
+        std::string path_for(const vImage_Buffer *image, const UserParameters &param, kind k) const;
+
+        std::size_t evict();
+
+    public:
+        /*!
+         * @param directory The directory holding the cache, which is
+         *   created if necessary.
+         * @param capacity The size in bytes beyond which the least
+         *   recently used results are removed, or 0 for no limit.
+         * @throw std::system_error If the directory cannot be created.
+         */
+        ResultCache(std::string directory, std::size_t capacity);
+
+        ResultCache(const ResultCache &) = delete;
+        ResultCache &operator =(const ResultCache &) = delete;
+
+        /*!
+         * @abstract Look up a result.
+         * @param image The analyzed image, in Planar8 format.
+         * @param param The parameters of the analysis.
+         * @param k The kind of result.
+         * @param result Where to store the result.
+         * @return @c true if the result was found.  A missing,
+         *   truncated, or corrupt file is a miss.
+         */
+        bool find(const vImage_Buffer *image, const UserParameters &param, kind k, std::vector<simd::double4> &result) const;
+
+        /*!
+         * @abstract Store a result.
+         * @discussion Failure to write is not an error, since the
+         *   result can always be recomputed.
+         */
+        void store(const vImage_Buffer *image, const UserParameters &param, kind k, const std::vector<simd::double4> &result);
+    };
+}
+
+#endif /* IAResultCache_hpp */
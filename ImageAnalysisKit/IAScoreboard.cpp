@@ -8,23 +8,33 @@
 
 #include "IAScoreboard.hpp"
 
+#include <dispatch/dispatch.h>
+
+#include <algorithm>
 #include <array>
+#include <numeric>
 #include <set>
 
 namespace IA {
-    // Angles will be measured in binary fractions of brads. This can be
-    // adjusted by the constant below.  Increasing this value increases
-    // the startup time and memory held by the trig tables.  Must be a
-    // power of two.
+    // Angles are measured in binary fractions of brads.  The number of
+    // angles per revolution is a template parameter of the voting
+    // code, so that its loops have constant bounds; these are the
+    // counts for which it is instantiated.  Each must be a power of
+    // two.
+
+#define ANGLE_COUNTS(X) X(256) X(512) X(1024) X(2048) X(4096)
 
-    constexpr vImagePixelCount max_theta = 2048;
+    static constexpr vImagePixelCount min_theta     = 256;
+    static constexpr vImagePixelCount max_theta     = 4096;
+    static constexpr vImagePixelCount default_theta = 2048;
 
-    struct TrigData : std::array<simd::double2, max_theta> {
+    template <vImagePixelCount Theta>
+    struct TrigData : std::array<simd::double2, Theta> {
         TrigData() {
-            constexpr double scale = 2.0f / static_cast<double>(max_theta);
+            constexpr double scale = 2.0 / static_cast<double>(Theta);
             simd::double2 * const value = this->data();
 
-            for (auto i = 0; i < max_theta; ++i) {
+            for (vImagePixelCount i = 0; i < Theta; ++i) {
                 double s, c;
                 __sincospi(scale * i, &s, &c);
                 value[i] = simd::double2 { c, s };
@@ -32,61 +42,534 @@ namespace IA {
         }
     };
 
-    static const TrigData trig;
+    // The tables are built on first use, so unused angle counts cost
+    // nothing.
+
+    template <vImagePixelCount Theta>
+    static const simd::double2 *trig_table() {
+        static const TrigData<Theta> table;
+        return table.data();
+    }
+
+    static const simd::double2 *trig_table(vImagePixelCount theta_count) {
+#define TABLE_CASE(T) case T: return trig_table<T>();
+        switch (theta_count) {
+            ANGLE_COUNTS(TABLE_CASE)
+        }
+#undef TABLE_CASE
+
+        throw VImageException(kvImageInvalidParameter);
+    }
+
+    vImagePixelCount angle_count(double diagonal, int requested) {
+        if (requested > 0) {
+            const auto count = static_cast<vImagePixelCount>(std::exp2(std::ceil(std::log2(requested))));
+            return std::min(std::max(count, min_theta), max_theta);
+        }
+
+        // Enough angles that adjacent ones differ by about a pixel
+        // across the image; smaller images cannot resolve more, so
+        // there is no point in voting for them.
+
+        const auto count = static_cast<vImagePixelCount>(std::exp2(std::ceil(std::log2(std::max(2.0 * M_PI * diagonal, 1.0)))));
+        return std::min(std::max(count, min_theta), default_theta);
+    }
 
-    Scoreboard::Scoreboard(const vImage_Buffer *image, const double threshold, const double seg_len_2, const double diagonal, const unsigned short max_gap, const unsigned short channel_radius)
-    : image(image), rho_scale(std::exp2(std::round(std::log2(max_theta) - std::log2(diagonal)))), status(image->height, image->width), accumulator(std::ceil(rho_scale * diagonal), max_theta), threshold(threshold), seg_len_2(seg_len_2), max_gap(max_gap), channel_radius(channel_radius) {
+    // The accumulator has about as many rows as columns, rounded to a
+    // power of two, unless memory is short.
+
+    static double rho_scale_for(double diagonal, const Resolution &resolution) {
+        return std::exp2(std::round(std::log2(resolution.angles) - std::log2(diagonal)) - resolution.rho_shift);
+    }
+
+    static Resolution resolve(Resolution resolution, double diagonal) {
+        if (resolution.angles == 0) resolution.angles = angle_count(diagonal, 0);
+        return resolution;
+    }
+
+    template <class Stats>
+    BasicScoreboard<Stats>::BasicScoreboard(trace::span &&, vImagePixelCount height, vImagePixelCount width, const double threshold, const double seg_len_2, const double diagonal, const unsigned short max_gap, const unsigned short channel_radius, Resolution resolution)
+    : theta_count(resolve(resolution, diagonal).angles), trig(trig_table(theta_count)), rho_scale(rho_scale_for(diagonal, resolve(resolution, diagonal))), status(height, width), accumulator(std::ceil(rho_scale * diagonal), theta_count), marks(height, width), threshold(threshold), seg_len_2(seg_len_2), max_gap(max_gap), channel_radius(channel_radius) {
         constexpr auto max = std::numeric_limits<uint16_t>::max();
-        if (image->width > max || image->height > max) {
+        if (width > max || height > max) {
             throw VImageException(kvImageInvalidImageFormat);
         }
 
+        memset(accumulator.data, 0, accumulator.height * accumulator.rowBytes);
+        memset(marks.data, 0, marks.height * marks.rowBytes);
+    }
+
+    // Edge pixels are those with the high bit set, so masking a word
+    // of pixels with these bits tests eight at once, and the position
+    // of each set bit gives the column of an edge pixel.
+
+    static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "edge masks assume little-endian words");
+
+    static constexpr uint64_t high_bits = 0x8080808080808080ULL;
+
+    // Images at least this large are scanned in parallel, in bands of
+    // about this many pixels.
+
+    static constexpr vImagePixelCount parallel_pixels = 1 << 22;
+    static constexpr vImagePixelCount band_pixels     = 1 << 20;
+
+    static inline uint64_t edge_mask(const uint8_t *src) {
+        uint64_t word;
+        memcpy(&word, src, sizeof(word));
+        return word & high_bits;
+    }
+
+    /*!
+     * @abstract Call a function with the column of each edge pixel in
+     *   a row, in order.
+     * @discussion Tests 32 pixels at a time, so the long runs of
+     *   background in a typical page cost one branch per 32 pixels.
+     */
+    template <class Function>
+    static inline void for_each_edge(const uint8_t *src, vImagePixelCount width, Function function) {
+        vImagePixelCount x = 0;
+
+        for (; x + 32 <= width; x += 32) {
+            const uint64_t mask[4] = {
+                edge_mask(src + x), edge_mask(src + x + 8), edge_mask(src + x + 16), edge_mask(src + x + 24)
+            };
+
+            if ((mask[0] | mask[1] | mask[2] | mask[3]) == 0) continue;
+
+            for (vImagePixelCount i = 0; i < 4; ++i) {
+                for (uint64_t bits = mask[i]; bits; bits &= bits - 1) {
+                    function(x + 8 * i + (__builtin_ctzll(bits) >> 3));
+                }
+            }
+        }
+
+        for (; x + 8 <= width; x += 8) {
+            for (uint64_t bits = edge_mask(src + x); bits; bits &= bits - 1) {
+                function(x + (__builtin_ctzll(bits) >> 3));
+            }
+        }
+
+        for (; x < width; ++x) {
+            if (src[x] >= 128U) function(x);
+        }
+    }
+
+    static inline std::size_t count_edges(const uint8_t *src, vImagePixelCount width) {
+        std::size_t count = 0;
+        vImagePixelCount x = 0;
+
+        for (; x + 8 <= width; x += 8) {
+            count += __builtin_popcountll(edge_mask(src + x));
+        }
+
+        for (; x < width; ++x) {
+            if (src[x] >= 128U) ++count;
+        }
+
+        return count;
+    }
+
+    /*!
+     * @abstract Call a function for each band of an image, in
+     *   parallel if requested.
+     */
+    template <class Function>
+    static void for_each_band(std::size_t bands, bool parallel, Function &function) {
+        if (!parallel) {
+            for (std::size_t band = 0; band < bands; ++band) function(band);
+            return;
+        }
+
+        dispatch_apply_f(bands, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), &function, [] (void *context, std::size_t band) {
+            (*static_cast<Function *>(context))(band);
+        });
+    }
+
+    /*!
+     * @abstract Find the edge pixels of an image in row-major order.
+     * @discussion The edge pixels of each band of rows are counted
+     *   first, so that the list is sized once and each band fills its
+     *   own part of it.
+     * @param edges The list to fill, replacing its contents.
+     * @param status If not @c NULL, a status map in which to mark each
+     *   pixel @c pending or @c unset.
+     */
+    static void scan_edges(const vImage_Buffer *image, edge_list &edges, const managed_buffer<status_t> *status) {
+        const vImagePixelCount height = image->height, width = image->width;
+
+        const vImagePixelCount band_rows = std::max<vImagePixelCount>(band_pixels / std::max<vImagePixelCount>(width, 1), 1);
+        const std::size_t bands = (height + band_rows - 1) / band_rows;
+        const bool parallel = bands > 1 && height * width >= parallel_pixels;
+
+        auto row = [image] (vImagePixelCount y) {
+            return static_cast<const uint8_t *>(image->data) + image->rowBytes * y;
+        };
+
+        // offsets[band] is the position in the list of the first edge
+        // pixel of the band.
+
+        std::vector<std::size_t> offsets(bands + 1, 0);
+
+        auto count = [&] (std::size_t band) {
+            const vImagePixelCount y_end = std::min(height, (band + 1) * band_rows);
+            std::size_t n = 0;
+
+            for (vImagePixelCount y = band * band_rows; y < y_end; ++y) {
+                n += count_edges(row(y), width);
+            }
+
+            offsets[band + 1] = n;
+        };
+
+        for_each_band(bands, parallel, count);
+
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+        edges.resize(offsets.back());
+
+        auto fill = [&] (std::size_t band) {
+            const vImagePixelCount y_end = std::min(height, (band + 1) * band_rows);
+            auto out = edges.begin() + offsets[band];
+
+            for (vImagePixelCount y = band * band_rows; y < y_end; ++y) {
+                status_t * const dst = status ? (*status)[y] : nullptr;
+
+                if (dst) std::fill_n(dst, width, status_t::unset);
+
+                for_each_edge(row(y), width, [&] (vImagePixelCount x) {
+                    *out++ = edge_list::value_type(x, y);
+                    if (dst) dst[x] = status_t::pending;
+                });
+            }
+        };
+
+        for_each_band(bands, parallel, fill);
+    }
+
+    edge_list find_edges(const vImage_Buffer *image) {
+        trace::span span { "find_edges" };
+
+        edge_list edges;
+        scan_edges(image, edges, nullptr);
+
+        return edges;
+    }
+
+    template <class Stats>
+    void BasicScoreboard<Stats>::begin_reset(const vImage_Buffer *image, point_t origin) {
+        if (image->width != status.width || image->height != status.height) {
+            throw VImageException(kvImageBufferSizeMismatch);
+        }
+
+        offset = origin;
+
+        if (seed) rng.seed(seed);
+
+        // The only cells of the register that are nonzero are those
+        // that were incremented by pixels left in the voted state by
+        // the previous image.  If there are few enough of them,
+        // withdrawing their votes is cheaper than clearing the
+        // entire register.
+
+        if (voted * (window.empty() ? theta_count : window.size()) >= accumulator.height * accumulator.width / 8) {
+            memset(accumulator.data, 0, accumulator.height * accumulator.rowBytes);
+            voted = 0;
+            vote_mass = 0;
+        }
+
+        for (vImagePixelCount y = 0; voted && y < status.height; ++y) {
+            const status_t * const dst = status[y];
+
+            for (vImagePixelCount x = 0; x < status.width; ++x) {
+                if (dst[x] == status_t::voted) unvote(x, y);
+            }
+        }
+
+        if (saturated) {
+            memset(accumulator.data, 0, accumulator.height * accumulator.rowBytes);
+            saturated = false;
+        }
+
+        queue.clear();
+
+        transformed = false;
+        peaks.clear();
+        next_peak = 0;
+
+        deadline = clock::now() + time_limit;
+        votes_cast = 0;
+        votes_since_segment = 0;
+        stopped_early = false;
+    }
+
+    template <class Stats>
+    void BasicScoreboard<Stats>::end_reset(const vImage_Buffer *image) {
+        assert(voted == 0);
+
+        if (orientation) estimate_orientations(image);
+
+        queued = queue.size();
+        polls = 0;
+
+        stats.add(&RunStats::edge_pixels, queue.size());
+    }
+
+    template <class Stats>
+    void BasicScoreboard<Stats>::reset(const vImage_Buffer *image, point_t origin) {
+        stats.clear();
+
+        typename Stats::scoped_timer timer { stats, &RunStats::setup_time };
+        trace::span span { "reset" };
+
+        begin_reset(image, origin);
+        scan_edges(image, queue, &status);
+        end_reset(image);
+    }
+
+    template <class Stats>
+    void BasicScoreboard<Stats>::reset(const vImage_Buffer *image, const edge_list &edges, point_t origin) {
+        stats.clear();
+
+        typename Stats::scoped_timer timer { stats, &RunStats::setup_time };
+        trace::span span { "reset" };
+
+        begin_reset(image, origin);
+
         for (vImagePixelCount y = 0; y < image->height; ++y) {
-            const uint8_t * const src = static_cast<const uint8_t *>(image->data) + image->rowBytes * y;
-            status_t * const dst = status[y];
+            std::fill_n(status[y], image->width, status_t::unset);
+        }
+
+        for (const auto &p : edges) {
+            status[p.second][p.first] = status_t::pending;
+        }
+
+        queue.assign(edges.begin(), edges.end());
+
+        end_reset(image);
+    }
+
+    template <class Stats>
+    void BasicScoreboard<Stats>::set_limits(double time_limit, unsigned long max_votes, unsigned long convergence_votes) {
+        const std::chrono::duration<double> seconds { std::max(time_limit, 0.0) };
+
+        this->time_limit = std::chrono::duration_cast<clock::duration>(seconds);
+        this->max_votes = max_votes;
+        this->convergence_votes = convergence_votes;
+    }
+
+    template <class Stats>
+    void BasicScoreboard<Stats>::set_angular_window(double degrees) {
+        assert(voted == 0);
+
+        window.clear();
+        in_window.clear();
+        window_bonus = 0;
+
+        const auto half_width = static_cast<vImagePixelCount>(std::floor(degrees / 360.0 * theta_count));
+
+        if (degrees <= 0 || 2 * half_width + 1 >= theta_count / 4) return;
+
+        // Lines near horizontal or vertical have normals near one of
+        // the four axes.
+
+        for (vImagePixelCount axis = 0; axis < theta_count; axis += theta_count / 4) {
+            for (vImagePixelCount d = 0; d <= 2 * half_width; ++d) {
+                window.push_back((axis + theta_count + d - half_width) & (theta_count - 1));
+            }
+        }
+
+        std::sort(window.begin(), window.end());
+
+        in_window.assign(theta_count, false);
+        for (const auto theta : window) in_window[theta] = true;
+
+        window_bonus = std::log(static_cast<double>(theta_count) / window.size());
+    }
 
-            for (vImagePixelCount x = 0; x < image->width; ++x) {
-                if (src[x] >= 128U) {
-                    queue.emplace_back(x, y);
-                    dst[x] = status_t::pending;
+    template <class Stats>
+    void BasicScoreboard<Stats>::set_orientation_window(double degrees) {
+        assert(voted == 0);
+
+        const auto radius = static_cast<vImagePixelCount>(std::floor(degrees / 360.0 * theta_count));
+
+        if (degrees <= 0 || 2 * radius + 1 >= theta_count / 4) {
+            orientation.reset();
+            orientation_radius = 0;
+        }
+        else {
+            if (!orientation) orientation.reset(new managed_buffer<uint16_t>(status.height, status.width));
+            orientation_radius = radius;
+        }
+    }
+
+    template <class Stats>
+    void BasicScoreboard<Stats>::estimate_orientations(const vImage_Buffer *image) {
+        trace::span span { "orientation" };
+
+        // The second moments of the edge pixels within this distance
+        // give the direction of the edge, and their coherence (the
+        // difference of the eigenvalues over their sum) how clearly
+        // there is one.  Thin lines have no gradient at their center,
+        // so a gradient operator would not do.
+
+        constexpr long radius = 3;
+        constexpr double min_coherence = 0.6;
+
+        const long height = image->height, width = image->width;
+
+        auto edge = [image] (long x, long y) {
+            return static_cast<const uint8_t *>(image->data)[image->rowBytes * y + x] >= 128U;
+        };
+
+        for (const auto &p : queue) {
+            const long x0 = p.first, y0 = p.second;
+
+            double n = 0, sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0;
+
+            for (long y = std::max(y0 - radius, 0L); y <= std::min(y0 + radius, height - 1); ++y) {
+                for (long x = std::max(x0 - radius, 0L); x <= std::min(x0 + radius, width - 1); ++x) {
+                    if (!edge(x, y)) continue;
+
+                    const double dx = x - x0, dy = y - y0;
+
+                    n   += 1;
+                    sx  += dx;
+                    sy  += dy;
+                    sxx += dx * dx;
+                    syy += dy * dy;
+                    sxy += dx * dy;
                 }
-                else {
-                    dst[x] = status_t::unset;
+            }
+
+            uint16_t normal = no_orientation;
+
+            if (n >= 3) {
+                const double a = sxx / n - (sx / n) * (sx / n);
+                const double b = syy / n - (sy / n) * (sy / n);
+                const double c = sxy / n - (sx / n) * (sy / n);
+
+                const double spread = std::hypot(a - b, 2 * c);
+
+                if (a + b > 0 && spread >= min_coherence * (a + b)) {
+                    // The edge runs along the major axis; the normal is
+                    // perpendicular to it.
+
+                    const double direction = 0.5 * std::atan2(2 * c, a - b);
+                    normal = static_cast<uint16_t>(std::lround((direction + M_PI_2) * (theta_count / (2.0 * M_PI))) & (theta_count - 1));
                 }
             }
+
+            (*orientation)[y0][x0] = normal;
+        }
+    }
+
+    template <class Stats>
+    double BasicScoreboard<Stats>::vote_weight(uint16_t normal) const {
+        if (normal == no_orientation) return 1.0;
+
+        // Both directions of the normal are visited, but as with a
+        // full sweep, only those with positive rho are counted.
+
+        return 2.0 * (2 * orientation_radius + 1) / theta_count;
+    }
+
+    template <class Stats>
+    template <vImagePixelCount Theta, class F>
+    void BasicScoreboard<Stats>::for_each_angle(uint16_t normal, F fn) const {
+        if (normal != no_orientation) {
+            for (vImagePixelCount d = 0; d <= 2 * orientation_radius; ++d) {
+                const vImagePixelCount theta = (normal + Theta + d - orientation_radius) & (Theta - 1);
+
+                const vImagePixelCount opposite = theta ^ (Theta / 2);
+
+                if (window.empty() || in_window[theta])    fn(theta);
+                if (window.empty() || in_window[opposite]) fn(opposite);
+            }
         }
+        else if (window.empty()) {
+            for (vImagePixelCount theta = 0; theta < Theta; ++theta) fn(theta);
+        }
+        else {
+            for (const vImagePixelCount theta : window) fn(theta);
+        }
+    }
 
-        memset(accumulator.data, 0, accumulator.height * accumulator.rowBytes);
+    template <class Stats>
+    bool BasicScoreboard<Stats>::limit_reached() {
+        ++votes_cast;
+        ++votes_since_segment;
+
+        if (max_votes && votes_cast > max_votes) return true;
+        if (convergence_votes && votes_since_segment > convergence_votes) return true;
+
+        // Reading the clock is far more expensive than the comparisons
+        // above, so only consult it periodically.
+
+        if (time_limit != clock::duration::zero() && (votes_cast & 0xff) == 0) {
+            if (clock::now() >= deadline) return true;
+        }
+
+        return false;
     }
 
-    bool Scoreboard::vote(const double x, const double y, vImagePixelCount &thetaOut, vImagePixelCount &rhoOut) {
-        const simd::double2 point { x, y };
+    template <class Stats>
+    void BasicScoreboard<Stats>::poll(std::size_t done, std::size_t total) {
+        if (!monitor) return;
+
+        monitor->check();
 
-        vImagePixelCount theta, rho;
+        if ((++polls & 0xff) == 0 && total) monitor->report(static_cast<double>(done) / total);
+    }
+
+    template <class Stats>
+    bool BasicScoreboard<Stats>::vote(const double x, const double y, const uint16_t *curve, vImagePixelCount &thetaOut, vImagePixelCount &rhoOut) {
+#define VOTE_CASE(T) case T: return vote<T>(x, y, curve, thetaOut, rhoOut);
+        switch (theta_count) {
+            ANGLE_COUNTS(VOTE_CASE)
+        }
+#undef VOTE_CASE
+
+        __builtin_unreachable();
+    }
+
+    template <class Stats>
+    template <vImagePixelCount Theta>
+    bool BasicScoreboard<Stats>::vote(const double x, const double y, const uint16_t *curve, vImagePixelCount &thetaOut, vImagePixelCount &rhoOut) {
+        const simd::double2 point { x, y };
 
         // Use a fixed-size buffer rather than a vector
         // because we are going to be resizing it frequently
         // and we know the maximum capacity.
 
-        std::array<std::pair<uint16_t, uint16_t>, max_theta> peaks;
+        std::array<std::pair<uint16_t, uint16_t>, Theta> peaks;
 
         auto const begin = peaks.begin();
         auto end = begin;
 
         counter_t n = 0;
+        unsigned long increments = 0;
 
-        for (theta = 0; theta < max_theta; ++theta) {
+        auto tally = [&](vImagePixelCount theta) {
             assert(end < peaks.end());
 
-            auto r = simd::dot(point, trig[theta]);
-            if (r < 0) continue;
+            vImagePixelCount rho;
+
+            if (curve) {
+                rho = *(curve++);
+                if (rho == no_rho) return;
+            }
+            else {
+                auto r = simd::dot(point, trig[theta]);
+                if (r < 0) return;
 
-            rho = std::lround(r * rho_scale);
-            if (rho >= accumulator.height) continue;
+                rho = std::lround(r * rho_scale);
+                if (rho >= accumulator.height) return;
+            }
 
             auto &count = accumulator[rho][theta];
 
             ++count;
+            ++increments;
 
             if (n < count) {
                 end = begin;
@@ -95,16 +578,27 @@ namespace IA {
             if (n == count) {
                 *(end++) = std::make_pair(theta, rho);
             }
-        }
+        };
+
+        const auto normal = orientation_at(static_cast<vImagePixelCount>(x), static_cast<vImagePixelCount>(y));
+
+        for_each_angle<Theta>(normal, tally);
+
+        stats.add(&RunStats::increments, increments);
 
         // There are maxTheta * maxRho cells in the register.
         // Each vote will increment maxTheta of these cells, one
         // per column.
         //
         // Assuming the null hypothesis (the image is random noise),
-        // E[n] = votes/maxRho for all cells in the register.
+        // E[n] = votes/maxRho for all cells in the register.  Votes
+        // guided by orientation fill fewer columns, and count only in
+        // proportion.
+
+        ++voted;
+        vote_mass += vote_weight(normal);
 
-        const double lambda = static_cast<double>(++voted) / accumulator.height;
+        const double lambda = vote_mass / accumulator.height;
 
         // For the null hypothesis, the cells are filled (roughly)
         // according to a Poisson model:
@@ -119,9 +613,10 @@ namespace IA {
         // randomly would contain a count of n. If the probability
         // is above the significance threshold, we assume that the
         // bin was filled by noise and tell the caller we did not
-        // find a segment.
+        // find a segment.  Within angular windows, fewer bins are
+        // tested, so a proportionally higher probability suffices.
 
-        if (lnp >= threshold) return false;
+        if (lnp >= threshold + window_bonus) return false;
 
         // We have rejected the null hypothesis.
 
@@ -132,29 +627,106 @@ namespace IA {
         return true;
     }
 
-    void Scoreboard::unvote(const double x, const double y) {
+    template <class Stats>
+    template <vImagePixelCount Theta>
+    void BasicScoreboard<Stats>::trace_curve(const double x, const double y, uint16_t *curve) const {
         const simd::double2 point { x, y };
 
-        vImagePixelCount theta, rho;
+        auto trace = [&](vImagePixelCount theta) {
+            auto r = simd::dot(point, trig[theta]);
+            const vImagePixelCount rho = std::lround(r * rho_scale);
+
+            *(curve++) = (r < 0 || rho >= accumulator.height) ? no_rho : static_cast<uint16_t>(rho);
+        };
+
+        const auto normal = orientation_at(static_cast<vImagePixelCount>(x), static_cast<vImagePixelCount>(y));
+
+        for_each_angle<Theta>(normal, trace);
+    }
+
+    template <class Stats>
+    void BasicScoreboard<Stats>::trace_curves() {
+        trace::span span { "trace_curves" };
+
+        curves.resize(batch.size() * theta_count);
+
+        // The curves depend only on the tables and the pixel, so the
+        // pixels of a batch can be traced concurrently.
 
-        for (theta = 0; theta < max_theta; ++theta) {
+        dispatch_apply_f(batch.size(), dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), this, [] (void *context, std::size_t i) {
+            const auto sb = static_cast<BasicScoreboard *>(context);
+
+            const double x = sb->batch[i].first, y = sb->batch[i].second;
+            uint16_t * const curve = sb->curves.data() + i * sb->theta_count;
+
+#define TRACE_CASE(T) case T: sb->trace_curve<T>(x, y, curve); return;
+            switch (sb->theta_count) {
+                ANGLE_COUNTS(TRACE_CASE)
+            }
+#undef TRACE_CASE
+        });
+    }
+
+    template <class Stats>
+    void BasicScoreboard<Stats>::unvote(const double x, const double y) {
+#define UNVOTE_CASE(T) case T: unvote<T>(x, y); return;
+        switch (theta_count) {
+            ANGLE_COUNTS(UNVOTE_CASE)
+        }
+#undef UNVOTE_CASE
+    }
+
+    template <class Stats>
+    template <vImagePixelCount Theta>
+    void BasicScoreboard<Stats>::unvote(const double x, const double y) {
+        const simd::double2 point { x, y };
+
+        auto withdraw = [&](vImagePixelCount theta) {
             auto r = simd::dot(point, trig[theta]);
-            if (r < 0) continue;
+            if (r < 0) return;
 
-            rho = std::lround(r * rho_scale);
-            if (rho >= accumulator.height) continue;
+            const vImagePixelCount rho = std::lround(r * rho_scale);
+            if (rho >= accumulator.height) return;
 
             auto &count = accumulator[rho][theta];
 
+            // A saturated cell holds fewer votes than were cast for
+            // it, so withdrawing them all could wrap it.  It is left
+            // as it is until the next reset clears it.
+
+            if (count == std::numeric_limits<counter_t>::max()) {
+                saturated = true;
+                return;
+            }
+
             assert(count > 0);
 
             --count;
-        }
+        };
+
+        const auto normal = orientation_at(static_cast<vImagePixelCount>(x), static_cast<vImagePixelCount>(y));
+
+        for_each_angle<Theta>(normal, withdraw);
+
+        vote_mass = --voted ? vote_mass - vote_weight(normal) : 0;
+
+        stats.add(&RunStats::points_unvoted);
+    }
+
+    template <class Stats>
+    std::size_t BasicScoreboard<Stats>::footprint(vImagePixelCount height, vImagePixelCount width, double diagonal, Resolution resolution) {
+        resolution = resolve(resolution, diagonal);
+
+        const std::size_t rows = std::ceil(rho_scale_for(diagonal, resolution) * diagonal);
 
-        --voted;
+        return height * width * sizeof(status_t)           // status map
+             + rows * resolution.angles * sizeof(counter_t) // accumulator
+             + height * width * sizeof(PointSet::epoch_t)  // candidate marks
+             + height * width * sizeof(coord_pair);         // queue
     }
 
-    std::pair<double, double> Scoreboard::find_range(vImagePixelCount width, vImagePixelCount height, simd::double2 p0, simd::double2 delta) {
+    template <class Stats>
+    std::pair<double, double> BasicScoreboard<Stats>::find_range(vImagePixelCount width, vImagePixelCount height, simd::double2 p0, simd::double2 delta) {
         simd::double4 bounds { 0, 0, static_cast<double>(width), static_cast<double>(height) };
 
         // This calculates the intercepts in parallel.
@@ -185,15 +757,33 @@ namespace IA {
         return range;
     }
 
-    std::vector<PointSet> Scoreboard::scan_channel(vImagePixelCount theta, double rho) const {
+    template <class Stats>
+    PointSet::epoch_t BasicScoreboard<Stats>::next_epoch() const {
+        // Once the epochs wrap around, a mark left by a scan long ago
+        // could be mistaken for one of the current scan.
+
+        if (++epoch == 0) {
+            memset(marks.data, 0, marks.height * marks.rowBytes);
+            epoch = 1;
+        }
+
+        return epoch;
+    }
+
+    template <class Stats>
+    std::vector<PointSet> BasicScoreboard<Stats>::scan_channel(vImagePixelCount theta, double rho, unsigned short radius) const {
         const simd::double2 norm  = trig[theta];
         const simd::double2 p0    = rho * trig[theta];
         const simd::double2 delta = simd::double2 { -1, +1 } * norm.yx / simd::norm_inf(norm);
 
         auto z_range = find_range(status.width, status.height, p0, delta);
 
+        stats.add(&RunStats::channel_scans);
+
+        const auto scan = next_epoch();
+
         std::vector<PointSet> segments;
-        segments.emplace_back(status);
+        segments.emplace_back(status, marks, scan);
 
         long gap = std::numeric_limits<long>::min();
 
@@ -207,7 +797,7 @@ namespace IA {
 
         std::set<simd::double2, __vec_less> points;
 
-        for (int c = -channel_radius; c <= channel_radius; ++c) {
+        for (int c = -radius; c <= radius; ++c) {
             points.insert(norm * c);
         }
 
@@ -231,7 +821,7 @@ namespace IA {
                 ++gap;
 
                 if (gap >= max_gap && !current.empty()) {
-                    segments.emplace_back(status);
+                    segments.emplace_back(status, marks, scan);
                 }
             }
         }
@@ -240,10 +830,317 @@ namespace IA {
             segments.pop_back();
         }
 
+        stats.add(&RunStats::candidates, segments.size());
+
         return segments;
     }
 
-    bool Scoreboard::next_segment(segment_t &segment) {
+    template <class Stats>
+    void BasicScoreboard<Stats>::refine(const segment_t &hint, unsigned short search_radius, std::vector<segment_t> &segments) {
+        const auto v = hint.hi - hint.lo;
+        if (simd::length_squared(v) == 0) return;
+
+        // Convert the hint to the normal form used by the register.
+
+        auto norm = simd::normalize(simd::double2 { -v.y, v.x });
+        auto rho  = simd::dot(norm, hint.lo - offset);
+
+        if (rho < 0) {
+            norm = -norm;
+            rho  = -rho;
+        }
+
+        const auto theta = static_cast<vImagePixelCount>(std::lround(std::atan2(norm.y, norm.x) * (theta_count / (2.0 * M_PI)))) & (theta_count - 1);
+
+        // Locate the line within the search channel.  The candidates
+        // claim nothing once the next scan begins.
+
+        {
+            auto candidates = scan_channel(theta, rho, search_radius);
+
+            double sum = 0;
+            std::size_t count = 0;
+
+            for (auto &candidate : candidates) {
+                for (const auto &p : candidate) {
+                    sum += simd::dot(trig[theta], simd::double2 { static_cast<double>(p.first), static_cast<double>(p.second) });
+                    ++count;
+                }
+            }
+
+            stats.add(&RunStats::candidates_discarded, candidates.size());
+
+            if (count == 0) return;
+
+            rho = sum / count;
+        }
+
+        for (auto &candidate : scan_channel(theta, rho)) {
+            if (candidate.length_squared() < seg_len_2) {
+                stats.add(&RunStats::candidates_discarded);
+                continue;
+            }
+
+            candidate.commit();
+
+            for (const auto &p : candidate) {
+                unvote(p.first, p.second);
+            }
+
+            segment_t segment = candidate;
+            segment.lo += offset;
+            segment.hi += offset;
+
+            segments.push_back(segment);
+        }
+    }
+
+    template <class Stats>
+    bool BasicScoreboard<Stats>::take_segment(vImagePixelCount theta, vImagePixelCount rho, segment_t &segment) {
+        auto segments = scan_channel(theta, rho / rho_scale);
+        if (segments.empty()) return false;
+
+        auto shorter = [] (const PointSet &a, const PointSet &b) {
+            return a.length_squared() < b.length_squared();
+        };
+
+        auto longest = std::max_element(segments.begin(), segments.end(), shorter);
+
+        longest->commit();
+
+        for (const auto &p : *longest) {
+            unvote(p.first, p.second);
+        }
+
+        const bool accepted = longest->length_squared() >= seg_len_2;
+
+        stats.add(&RunStats::candidates_discarded, segments.size() - accepted);
+
+        if (accepted) {
+            segment = *longest;
+            segment.lo += offset;
+            segment.hi += offset;
+            votes_since_segment = 0;
+        }
+
+        return accepted;
+    }
+
+    // The standard transform divides the accumulator among threads
+    // by columns of this many angles, so no thread writes a column
+    // another thread writes.
+
+    static constexpr vImagePixelCount slice_angles = 64;
+
+    template <class Stats>
+    bool BasicScoreboard<Stats>::votes_for(uint16_t normal, vImagePixelCount theta) const {
+        if (!window.empty() && !in_window[theta]) return false;
+        if (normal == no_orientation) return true;
+
+        // The same angles as for_each_angle: those within the radius
+        // of the normal, or of its opposite.
+
+        const vImagePixelCount mask = theta_count - 1;
+
+        const vImagePixelCount d = (theta + theta_count - normal + orientation_radius) & mask;
+        const vImagePixelCount e = ((theta ^ (theta_count / 2)) + theta_count - normal + orientation_radius) & mask;
+
+        return d <= 2 * orientation_radius || e <= 2 * orientation_radius;
+    }
+
+    template <class Stats>
+    unsigned long BasicScoreboard<Stats>::transform_slice(vImagePixelCount theta_begin, vImagePixelCount theta_end) {
+        unsigned long increments = 0;
+
+        for (const auto &p : queue) {
+            const simd::double2 point { static_cast<double>(p.first), static_cast<double>(p.second) };
+            const auto normal = orientation_at(p.first, p.second);
+
+            for (vImagePixelCount theta = theta_begin; theta < theta_end; ++theta) {
+                if (!votes_for(normal, theta)) continue;
+
+                auto r = simd::dot(point, trig[theta]);
+                if (r < 0) continue;
+
+                const vImagePixelCount rho = std::lround(r * rho_scale);
+                if (rho >= accumulator.height) continue;
+
+                // No vote is withdrawn until every pixel has voted, so
+                // a bin gathering a dense page (or, at coarse rho,
+                // several rows of one) can overflow its counter.  A
+                // saturated count still wins every comparison, and
+                // unvote leaves it alone.
+
+                auto &count = accumulator[rho][theta];
+                if (count == std::numeric_limits<counter_t>::max()) continue;
+
+                ++count;
+                ++increments;
+            }
+        }
+
+        return increments;
+    }
+
+    template <class Stats>
+    void BasicScoreboard<Stats>::find_peaks_in_slice(vImagePixelCount theta_begin, vImagePixelCount theta_end, std::vector<std::tuple<counter_t, uint16_t, uint16_t>> &found) const {
+        const vImagePixelCount mask = theta_count - 1;
+
+        for (vImagePixelCount rho = 0; rho < accumulator.height; ++rho) {
+            for (vImagePixelCount theta = theta_begin; theta < theta_end; ++theta) {
+                const counter_t count = accumulator[rho][theta];
+                if (count < min_peak) continue;
+
+                // Keep only local maxima.  Of equal neighbors, the
+                // first in row-major order wins, so a plateau yields
+                // one peak.
+
+                bool maximum = true;
+
+                for (long dr = -1; maximum && dr <= 1; ++dr) {
+                    const long r = static_cast<long>(rho) + dr;
+                    if (r < 0 || r >= static_cast<long>(accumulator.height)) continue;
+
+                    for (long dt = -1; maximum && dt <= 1; ++dt) {
+                        if (dr == 0 && dt == 0) continue;
+
+                        const vImagePixelCount t = (theta + theta_count + dt) & mask;
+                        const counter_t neighbor = accumulator[r][t];
+
+                        const bool before = r < static_cast<long>(rho) || (r == static_cast<long>(rho) && t < theta);
+
+                        maximum = before ? count > neighbor : count >= neighbor;
+                    }
+                }
+
+                if (maximum) found.emplace_back(count, theta, rho);
+            }
+        }
+    }
+
+    template <class Stats>
+    void BasicScoreboard<Stats>::transform() {
+        trace::span span { "transform" };
+
+        struct work {
+            BasicScoreboard *sb;
+            std::vector<unsigned long> increments;
+        } context { this, std::vector<unsigned long>(theta_count / slice_angles) };
+
+        dispatch_apply_f(context.increments.size(), dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), &context, [] (void *context, std::size_t i) {
+            auto c = static_cast<work *>(context);
+            c->increments[i] = c->sb->transform_slice(i * slice_angles, (i + 1) * slice_angles);
+        });
+
+        for (const auto n : context.increments) {
+            stats.add(&RunStats::increments, n);
+        }
+
+        // Every pixel has now voted, so segments can withdraw their
+        // votes as usual.
+
+        for (const auto &p : queue) {
+            status[p.second][p.first] = status_t::voted;
+            vote_mass += vote_weight(orientation_at(p.first, p.second));
+        }
+
+        voted += queue.size();
+
+        stats.add(&RunStats::votes, queue.size());
+
+        queue.clear();
+    }
+
+    template <class Stats>
+    void BasicScoreboard<Stats>::find_peaks() {
+        trace::span span { "find_peaks" };
+
+        // The smallest count that fails the Poisson test of a vote.
+
+        const double lambda = vote_mass / accumulator.height;
+
+        counter_t n = static_cast<counter_t>(std::min(std::max(std::floor(lambda), 1.0), static_cast<double>(UINT16_MAX)));
+
+        while (n < UINT16_MAX && n * std::log(lambda) - std::lgamma(n + 1) - lambda >= threshold + window_bonus) ++n;
+
+        min_peak = n;
+
+        using peak = std::tuple<counter_t, uint16_t, uint16_t>;
+
+        struct search {
+            const BasicScoreboard *sb;
+            std::vector<std::vector<peak>> found;
+        } context { this, std::vector<std::vector<peak>>(theta_count / slice_angles) };
+
+        dispatch_apply_f(context.found.size(), dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), &context, [] (void *context, std::size_t i) {
+            auto c = static_cast<search *>(context);
+            c->sb->find_peaks_in_slice(i * slice_angles, (i + 1) * slice_angles, c->found[i]);
+        });
+
+        std::vector<peak> all;
+
+        for (const auto &found : context.found) {
+            all.insert(all.end(), found.begin(), found.end());
+        }
+
+        // Strongest first; ties in a fixed order, so the result does
+        // not depend on the scheduling of the slices.
+
+        std::sort(all.begin(), all.end(), [] (const peak &a, const peak &b) {
+            if (std::get<0>(a) != std::get<0>(b)) return std::get<0>(a) > std::get<0>(b);
+            return std::make_pair(std::get<2>(a), std::get<1>(a)) < std::make_pair(std::get<2>(b), std::get<1>(b));
+        });
+
+        peaks.clear();
+        peaks.reserve(all.size());
+
+        for (const auto &p : all) {
+            peaks.emplace_back(std::get<1>(p), std::get<2>(p));
+        }
+    }
+
+    template <class Stats>
+    bool BasicScoreboard<Stats>::next_segment_standard(segment_t &segment) {
+        typename Stats::scoped_timer timer { stats, &RunStats::vote_time };
+        trace::span span { "vote" };
+
+        if (!transformed) {
+            transform();
+            find_peaks();
+            transformed = true;
+        }
+
+        while (next_peak < peaks.size()) {
+            poll(next_peak, peaks.size());
+
+            const vImagePixelCount theta = peaks[next_peak].first;
+            const vImagePixelCount rho   = peaks[next_peak].second;
+
+            // Segments already found may have withdrawn the votes that
+            // made this a peak.  Otherwise stay on the peak after a
+            // segment, since its line may hold more.
+
+            if (accumulator[rho][theta] < min_peak || !take_segment(theta, rho, segment)) {
+                ++next_peak;
+                continue;
+            }
+
+            return true;
+        }
+
+        if (monitor) monitor->report(1.0);
+
+        return false;
+    }
+
+    template <class Stats>
+    bool BasicScoreboard<Stats>::next_segment(segment_t &segment) {
+        if (standard) return next_segment_standard(segment);
+        if (batch_size > 1) return next_segment_batched(segment);
+
+        typename Stats::scoped_timer timer { stats, &RunStats::vote_time };
+        trace::span span { "vote" };
+
         auto const q_begin = queue.begin();
         auto q_end         = queue.end();
 
@@ -257,38 +1154,131 @@ namespace IA {
             *iter = *(--q_end);
 
             status_t &cell = status[y][x];
-            if (cell != status_t::pending) continue;
+            if (cell != status_t::pending) {
+                stats.add(&RunStats::stale_entries);
+                continue;
+            }
+
+            poll(queued - (q_end - q_begin), queued);
+
+            if (limit_reached()) {
+                stopped_early = true;
+                break;
+            }
 
             cell = status_t::voted;
 
+            stats.add(&RunStats::votes);
+
             vImagePixelCount theta, rho;
 
-            if (vote(x, y, theta, rho)) {
-                auto segments = scan_channel(theta, rho / rho_scale);
-                if (segments.empty()) continue;
+            if (vote(x, y, nullptr, theta, rho)) {
+                if (take_segment(theta, rho, segment)) {
+                    queue.erase(q_end, queue.end());
+                    return true;
+                }
+            }
+            else {
+                stats.add(&RunStats::votes_rejected);
+            }
+        }
+
+        queue.clear();
+
+        if (monitor) monitor->report(1.0);
+
+        return false;
+    }
+
+    template <class Stats>
+    bool BasicScoreboard<Stats>::next_segment_batched(segment_t &segment) {
+        typename Stats::scoped_timer timer { stats, &RunStats::vote_time };
+        trace::span span { "vote" };
+
+        auto const q_begin = queue.begin();
+        auto q_end         = queue.end();
+
+        while (q_end != q_begin && !stopped_early) {
+            // Draw a batch exactly as single pixels are drawn.  The
+            // slots vacated at the end of the queue are reused if the
+            // batch is not used up.
 
-                auto shorter = [] (const PointSet &a, const PointSet &b) {
-                    return a.length_squared() < b.length_squared();
-                };
+            batch.clear();
 
-                auto longest = std::max_element(segments.begin(), segments.end(), shorter);
+            while (batch.size() < batch_size && q_end != q_begin) {
+                auto iter = q_begin + std::uniform_int_distribution<std::size_t>(0, (q_end - q_begin - 1))(rng);
 
-                longest->commit();
+                const auto p = *iter;
 
-                for (const auto &p : *longest) {
-                    unvote(p.first, p.second);
+                *iter = *(--q_end);
+
+                if (status[p.second][p.first] != status_t::pending) {
+                    stats.add(&RunStats::stale_entries);
+                    continue;
                 }
 
-                if (longest->length_squared() >= seg_len_2) {
-                    segment = *longest;
-                    queue.erase(q_end, queue.end());
-                    return true;
+                batch.push_back(p);
+            }
+
+            if (batch.empty()) break;
+
+            trace_curves();
+
+            // Replay the votes in the order drawn.
+
+            for (std::size_t i = 0; i < batch.size(); ++i) {
+                const uint16_t x = batch[i].first;
+                const uint16_t y = batch[i].second;
+
+                // A segment committed earlier in the batch may have
+                // claimed the pixel, in which case its curve is
+                // discarded, as a sequential draw would have found it
+                // stale.
+
+                status_t &cell = status[y][x];
+                if (cell != status_t::pending) {
+                    stats.add(&RunStats::stale_entries);
+                    continue;
+                }
+
+                poll(queued - (q_end - q_begin) - (batch.size() - i), queued);
+
+                if (limit_reached()) {
+                    stopped_early = true;
+                    break;
+                }
+
+                cell = status_t::voted;
+
+                stats.add(&RunStats::votes);
+
+                vImagePixelCount theta, rho;
+
+                if (vote(x, y, curves.data() + i * theta_count, theta, rho)) {
+                    if (take_segment(theta, rho, segment)) {
+                        for (std::size_t j = i + 1; j < batch.size(); ++j) {
+                            *(q_end++) = batch[j];
+                        }
+
+                        queue.erase(q_end, queue.end());
+                        return true;
+                    }
+                }
+                else {
+                    stats.add(&RunStats::votes_rejected);
                 }
             }
         }
 
         queue.clear();
 
+        if (monitor) monitor->report(1.0);
+
         return false;
     }
+
+    template class BasicScoreboard<NullStats>;
+    template class BasicScoreboard<CollectStats>;
+
+#undef ANGLE_COUNTS
 }
@@ -13,49 +13,462 @@
 
 #include "IABase.hpp"
 #include "IAManagedBuffer.hpp"
+#include "IAMonitor.hpp"
 #include "IAPointSet.hpp"
+#include "IAStats.hpp"
+#include "IATrace.hpp"
 
+#include <chrono>
 #include <cstdint>
+#include <memory>
 #include <random>
 #include <tuple>
 #include <utility>
 #include <vector>
 
 namespace IA {
-    class Scoreboard {
+    /*!
+     * @abstract The resolution of a scoreboard's accumulator.
+     */
+    struct Resolution {
+        unsigned rho_shift = 0;         // halvings of the rho resolution, to save memory
+        vImagePixelCount angles = 0;    // angles per revolution, or 0 to choose from the diagonal
+    };
+
+    /*!
+     * @abstract Choose the number of angles per revolution for the
+     *   accumulator.
+     * @param diagonal The length of the diagonal of the image.
+     * @param requested The @c angleCount parameter: a count, which is
+     *   rounded up to a power of two between 256 and 4096, or 0 to
+     *   choose from the diagonal (at most 2048).
+     */
+    vImagePixelCount angle_count(double diagonal, int requested);
+
+    /*!
+     * @abstract The edge pixels of an image, in row-major order.
+     */
+    using edge_list = std::vector<std::pair<uint16_t, uint16_t>>;
+
+    /*!
+     * @abstract Find the edge pixels of an image.
+     * @discussion The result depends only on the image, so it can be
+     *   shared by scoreboards analyzing the same image with different
+     *   parameters; see @c BasicScoreboard::reset.
+     * @param image The image, in Planar8 format, no larger than 65535
+     *   pixels in either dimension.
+     */
+    edge_list find_edges(const vImage_Buffer *image);
+
+    /*!
+     * @abstract The voting register and status map of the progressive
+     *   probabilistic Hough transform.
+     * @tparam Stats The statistics policy: @c NullStats to record
+     *   nothing at no cost, or @c CollectStats to record the counters
+     *   in @c RunStats.
+     */
+    template <class Stats>
+    class BasicScoreboard {
         using counter_t  = uint16_t;
-        using coord_pair = std::pair<uint16_t, uint16_t>;
+        using coord_pair = edge_list::value_type;
 
-        const vImage_Buffer * const image;
+        const vImagePixelCount theta_count;
+        const simd::double2 * const trig;
 
         const double rho_scale;
 
         managed_buffer<status_t> status;
         managed_buffer<counter_t> accumulator;
 
+        // The scan that last claimed each pixel for a candidate
+        // segment.  A new epoch per scan releases the claims of the
+        // previous one without touching the pixels.
+
+        managed_buffer<PointSet::epoch_t> marks;
+        mutable PointSet::epoch_t epoch = 0;
+
+        PointSet::epoch_t next_epoch() const;
+
         const double threshold;
         const double seg_len_2;
         const unsigned short max_gap;
         const unsigned short channel_radius;
 
-        std::vector<coord_pair> queue;
+        point_t offset = point_t { 0, 0 };
+
+        edge_list queue;
         std::default_random_engine rng { std::random_device{}() };
+        unsigned seed = 0;
 
         unsigned voted = 0;
 
-        bool vote(const double x, const double y, vImagePixelCount &theta, vImagePixelCount &rho);
+        // The expected number of votes in each accumulator cell times
+        // its height; less than the number of votes when pixels vote
+        // for only some of the angles.
+
+        double vote_mass = 0;
+
+        // Whether a vote was withdrawn from a saturated cell, which
+        // then no longer counts its votes and must be cleared before
+        // the next image.
+
+        bool saturated = false;
+
+        // The angles voted for, if not all of them, the same as a
+        // mask, and the amount by which the threshold is relaxed
+        // because fewer cells are tested.
+
+        std::vector<uint16_t> window;
+        std::vector<bool> in_window;
+        double window_bonus = 0;
+
+        // The angle of the normal at each queued pixel, estimated
+        // from its neighbors, and the number of angles either side of
+        // it to vote for.  Absent unless orientation-guided voting is
+        // enabled.
+
+        static constexpr uint16_t no_orientation = UINT16_MAX;
+
+        std::unique_ptr<managed_buffer<uint16_t>> orientation;
+        vImagePixelCount orientation_radius = 0;
+
+        void estimate_orientations(const vImage_Buffer *image);
+
+        uint16_t orientation_at(vImagePixelCount x, vImagePixelCount y) const {
+            return orientation ? (*orientation)[y][x] : no_orientation;
+        }
+
+        double vote_weight(uint16_t normal) const;
+
+        // Batched voting: the pixels drawn together, and the rho of
+        // each of their votes (theta_count per pixel, in the order of
+        // for_each_angle), computed in parallel.
+
+        static constexpr uint16_t no_rho = UINT16_MAX;
+
+        vImagePixelCount batch_size = 1;
+        edge_list batch;
+        std::vector<uint16_t> curves;
+
+        void trace_curves();
+
+        template <vImagePixelCount Theta>
+        void trace_curve(const double x, const double y, uint16_t *curve) const;
+
+        template <vImagePixelCount Theta, class F>
+        void for_each_angle(uint16_t normal, F fn) const;
+
+        using clock = std::chrono::steady_clock;
+
+        clock::duration time_limit = clock::duration::zero();
+        unsigned long max_votes = 0;
+        unsigned long convergence_votes = 0;
+
+        clock::time_point deadline;
+        unsigned long votes_cast = 0;
+        unsigned long votes_since_segment = 0;
+        bool stopped_early = false;
+
+        mutable Stats stats;
+
+        // The observer of the analysis, if any, and the number of
+        // pixels queued by the last reset().
+
+        const Monitor *monitor = nullptr;
+        std::size_t queued = 0;
+        unsigned long polls = 0;
+
+        bool limit_reached();
+        void poll(std::size_t done, std::size_t total);
+
+        // The parts of reset() before and after the status map is
+        // filled.
+
+        void begin_reset(const vImage_Buffer *image, point_t origin);
+        void end_reset(const vImage_Buffer *image);
+
+        // The voting functions dispatch on the angle count to
+        // versions in which it is a constant.
+
+        bool vote(const double x, const double y, const uint16_t *curve, vImagePixelCount &theta, vImagePixelCount &rho);
         void unvote(const double x, const double y);
 
+        template <vImagePixelCount Theta>
+        bool vote(const double x, const double y, const uint16_t *curve, vImagePixelCount &theta, vImagePixelCount &rho);
+
+        template <vImagePixelCount Theta>
+        void unvote(const double x, const double y);
+
+        // The standard Hough transform: every pixel votes at once, and
+        // segments are sought along the peaks of the accumulator,
+        // strongest first.
+
+        bool standard = false;
+        bool transformed = false;
+        counter_t min_peak = 0;
+        std::vector<std::pair<uint16_t, uint16_t>> peaks;   // theta, rho
+        std::size_t next_peak = 0;
+
+        bool votes_for(uint16_t normal, vImagePixelCount theta) const;
+        unsigned long transform_slice(vImagePixelCount theta_begin, vImagePixelCount theta_end);
+        void find_peaks_in_slice(vImagePixelCount theta_begin, vImagePixelCount theta_end, std::vector<std::tuple<counter_t, uint16_t, uint16_t>> &found) const;
+        void transform();
+        void find_peaks();
+
+        bool take_segment(vImagePixelCount theta, vImagePixelCount rho, segment_t &segment);
+
         bool next_segment(segment_t &segment);
+        bool next_segment_batched(segment_t &segment);
+        bool next_segment_standard(segment_t &segment);
+
+        // The span is opened by the public constructor, so that it
+        // covers the allocation of the buffers as well.
+
+        BasicScoreboard(trace::span &&span, vImagePixelCount height, vImagePixelCount width, const double threshold, const double seg_len_2, const double diagonal, const unsigned short max_gap, const unsigned short channel_radius, Resolution resolution);
 
     public:
-        Scoreboard(const vImage_Buffer *image, const double threshold, const double seg_len_2, const double diagonal, const unsigned short max_gap, const unsigned short channel_radius);
+        /*!
+         * @param resolution The resolution of the accumulator.  Smaller
+         *   angle counts make votes proportionally cheaper and the
+         *   accumulator proportionally smaller.
+         */
+        BasicScoreboard(vImagePixelCount height, vImagePixelCount width, const double threshold, const double seg_len_2, const double diagonal, const unsigned short max_gap, const unsigned short channel_radius, Resolution resolution = Resolution { }) : BasicScoreboard(trace::span { "Scoreboard" }, height, width, threshold, seg_len_2, diagonal, max_gap, channel_radius, resolution) { }
+
+        /*!
+         * @param resolution The resolution of the accumulator.  If it
+         *   does not give an angle count, the @c angleCount parameter
+         *   is used.
+         */
+        BasicScoreboard(vImagePixelCount height, vImagePixelCount width, const UserParameters &param, Resolution resolution = Resolution { }) : BasicScoreboard(height, width, param.sensitivity * -M_LN10, param.minSegmentLength * param.minSegmentLength, std::ceil(std::hypot(width, height)), std::max(param.maxGap, 0), ((std::max<short>(param.channelWidth, 3) - 1) >> 1), Resolution { resolution.rho_shift, resolution.angles ? resolution.angles : angle_count(std::ceil(std::hypot(width, height)), param.angleCount) }) {
+            set_limits(param.timeLimit, std::max(param.maxVotes, 0), std::max(param.convergenceVotes, 0));
+            set_angular_window(param.angularWindow);
+            set_orientation_window(param.orientationWindow);
+            set_seed(param.seed);
+            set_vote_batch(std::max(param.voteBatchSize, 1));
+            set_standard(param.standardHough != 0);
+        }
+
+        BasicScoreboard(const vImage_Buffer *image, const UserParameters &param) : BasicScoreboard(image->height, image->width, param) {
+            reset(image);
+        }
+
+        /*!
+         * @abstract Prepare the scoreboard to analyze a new image.
+         * @discussion The image must have the dimensions given when
+         *   the scoreboard was constructed.  Only the accumulator
+         *   cells still holding votes from the previous image are
+         *   cleared, so reusing a scoreboard is considerably cheaper
+         *   than constructing a new one.
+         *
+         *   The image may be a view of a region of a larger buffer
+         *   (see @c make_roi), in which case @p origin is the position
+         *   of the region within the larger buffer.  Segments are
+         *   reported, and hints given to @c refine, in the coordinates
+         *   of the larger buffer.
+         * @param image The image to analyze, in Planar8 format.
+         * @param origin The position of the image's first pixel.
+         * @throw VImageException If the image size does not match.
+         */
+        void reset(const vImage_Buffer *image, point_t origin = point_t { 0, 0 });
+
+        /*!
+         * @abstract Prepare the scoreboard to analyze a new image whose
+         *   edge pixels are already known.
+         * @discussion Identical to the other form of @c reset(), but
+         *   skips the scan of the image for edge pixels.
+         * @param image The image to analyze, in Planar8 format.
+         * @param edges The edge pixels of @p image, as returned by @c
+         *   find_edges.
+         * @param origin The position of the image's first pixel.
+         * @throw VImageException If the image size does not match.
+         */
+        void reset(const vImage_Buffer *image, const edge_list &edges, point_t origin = point_t { 0, 0 });
+
+        point_t origin() const {
+            return offset;
+        }
+
+        /*!
+         * @abstract Bound the work done on an image.
+         * @discussion When a limit is reached, the iteration ends
+         *   early with the segments found so far and @c partial()
+         *   returns true.  A value of zero disables a limit.
+         * @param time_limit The seconds of voting allowed after @c
+         *   reset().
+         * @param max_votes The number of votes allowed.
+         * @param convergence_votes The number of consecutive votes
+         *   allowed without finding a segment.
+         */
+        void set_limits(double time_limit, unsigned long max_votes, unsigned long convergence_votes);
+
+        /*!
+         * @abstract Vote only for lines within some angle of
+         *   horizontal or vertical.
+         * @discussion Votes and peak searches skip every other angle,
+         *   so they are cheaper in proportion to the angles skipped,
+         *   and lines outside the windows are never found.  Since
+         *   fewer accumulator cells are tested against the Poisson
+         *   model, the significance threshold is relaxed by the same
+         *   proportion, as for a Bonferroni correction.
+         *
+         *   Must not be called while votes are outstanding, i.e.,
+         *   between @c reset() and the end of the analysis.
+         * @param degrees The half-width of each window, or 0 (or 45 or
+         *   more) to vote for all angles.
+         */
+        void set_angular_window(double degrees);
+
+        /*!
+         * @abstract Have each pixel vote only for lines roughly along
+         *   the edge it lies on.
+         * @discussion The direction of the edge through each pixel is
+         *   estimated from the moments of the edge pixels around it,
+         *   and the pixel votes only for the angles within @p degrees
+         *   of that direction.  Pixels without a clear direction, such
+         *   as those at corners or in blobs, vote for all angles.  This
+         *   makes most votes far cheaper and keeps the votes of busy
+         *   regions from blurring the peaks of real lines.  The Poisson
+         *   model accounts for the smaller number of cells each vote
+         *   fills.
+         *
+         *   Costs two bytes per pixel.  Must not be called while votes
+         *   are outstanding.
+         * @param degrees The half-width of the window, or 0 (or 45 or
+         *   more) to vote for all angles.
+         */
+        void set_orientation_window(double degrees);
+
+        /*!
+         * @abstract Make the analysis of each image reproducible.
+         * @discussion The random number generator that chooses the
+         *   order of votes is reseeded by each @c reset(), so an image
+         *   yields the same segments however many images the
+         *   scoreboard has analyzed before it.
+         * @param seed The seed, or 0 to leave the order random.
+         */
+        void set_seed(unsigned seed) {
+            this->seed = seed;
+        }
+
+        /*!
+         * @abstract Vote for several pixels at a time.
+         * @discussion Each time the queue is drawn from, up to @p size
+         *   pending pixels are drawn, and the cells each would vote
+         *   for are computed in parallel.  The votes are then cast in
+         *   the order drawn, with the usual test after each, so the
+         *   analysis remains a progressive Hough transform.  Pixels
+         *   claimed by a segment found earlier in the batch are
+         *   skipped, and those left when a segment is reported are
+         *   returned to the queue.
+         *
+         *   Costs two bytes per angle per pixel in a batch.
+         * @param size The number of pixels per batch, or 1 to vote
+         *   for one pixel at a time.  Larger sizes are reduced to @c
+         *   max_vote_batch.
+         */
+        void set_vote_batch(vImagePixelCount size) {
+            batch_size = std::min(std::max<vImagePixelCount>(size, 1), max_vote_batch());
+        }
 
-        Scoreboard(const vImage_Buffer *image, const UserParameters &param) : Scoreboard(image, param.sensitivity * -M_LN10, param.minSegmentLength * param.minSegmentLength, std::ceil(std::hypot(image->width, image->height)), std::max(param.maxGap, 0), ((std::max<short>(param.channelWidth, 3) - 1) >> 1)) { }
+        /*!
+         * @abstract The most pixels drawn in one vote batch.
+         * @discussion Bounds the curves of a batch at 32 MB at the
+         *   finest angular resolution.
+         */
+        static vImagePixelCount max_vote_batch() {
+            return 4096;
+        }
+
+        /*!
+         * @abstract Use the standard Hough transform rather than the
+         *   progressive one.
+         * @discussion Every edge pixel votes at once, the votes divided
+         *   among threads by angle, and segments are sought by @c
+         *   scan_channel along the local maxima of the accumulator
+         *   that pass the Poisson test, strongest first.  The votes of
+         *   the pixels in each segment are withdrawn, so weaker peaks
+         *   that they supported are skipped.  On dense edge maps,
+         *   where nearly every pixel would vote and be withdrawn
+         *   anyway, this is faster than voting one pixel at a time.
+         *
+         *   The limits set by @c set_limits and the vote batch size
+         *   do not apply.  Must not be called while votes are
+         *   outstanding.
+         */
+        void set_standard(bool standard) {
+            this->standard = standard;
+        }
+
+        /*!
+         * @abstract Let a monitor observe and cancel the analysis.
+         * @discussion The monitor is checked before each vote (or,
+         *   for the standard transform, each peak), and told the
+         *   fraction of the queue consumed every 256 votes and when
+         *   the queue is exhausted.  If it has been cancelled, the
+         *   analysis throws; the scoreboard may then be reset and
+         *   reused.
+         * @param monitor The monitor, which must outlive its use, or
+         *   @c nullptr.
+         */
+        void set_monitor(const Monitor *monitor) {
+            this->monitor = monitor;
+        }
+
+        /*!
+         * @abstract Whether the last image was abandoned at one of the
+         *   limits set by @c set_limits.
+         */
+        bool partial() const {
+            return stopped_early;
+        }
+
+        /*!
+         * @abstract The counters recorded since the last @c reset().
+         * @discussion Always zero under the @c NullStats policy.
+         */
+        RunStats statistics() const {
+            return stats.get();
+        }
+
+        /*!
+         * @abstract Estimate the memory held by a scoreboard.
+         * @discussion The queue is assumed to hold every pixel, so the
+         *   estimate is an upper bound.
+         * @param diagonal The length of the diagonal of the image.
+         * @param resolution As for the constructor.
+         * @return The number of bytes.
+         */
+        static std::size_t footprint(vImagePixelCount height, vImagePixelCount width, double diagonal, Resolution resolution = Resolution { });
+
+        /*!
+         * @abstract The number of angles per revolution in the
+         *   accumulator.
+         */
+        vImagePixelCount angles() const {
+            return theta_count;
+        }
 
         static std::pair<double, double> find_range(vImagePixelCount width, vImagePixelCount height, simd::double2 p0, simd::double2 delta);
 
-        std::vector<PointSet> scan_channel(vImagePixelCount theta, double rho) const;
+        std::vector<PointSet> scan_channel(vImagePixelCount theta, double rho, unsigned short radius) const;
+
+        std::vector<PointSet> scan_channel(vImagePixelCount theta, double rho) const {
+            return scan_channel(theta, rho, channel_radius);
+        }
+
+        /*!
+         * @abstract Commit the segments lying along a known line.
+         * @discussion The line is located within a channel of the
+         *   given radius around the hint by the mean position of the
+         *   pixels in the channel, and the segments along the located
+         *   line that meet the minimum length are committed exactly as
+         *   if they had been found by voting.
+         * @param hint A segment approximating the line.
+         * @param search_radius The distance from the hint within which
+         *   to search for the line.
+         * @param segments The vector to which to append the segments.
+         */
+        void refine(const segment_t &hint, unsigned short search_radius, std::vector<segment_t> &segments);
 
         struct iterator {
             using difference_type   = std::ptrdiff_t;
@@ -65,7 +478,7 @@ namespace IA {
             using iterator_category = std::input_iterator_tag;
 
         private:
-            Scoreboard *sb;
+            BasicScoreboard *sb;
             value_type current;
 
             std::default_random_engine rng { std::random_device{}() };
@@ -76,7 +489,7 @@ namespace IA {
             }
 
         public:
-            iterator(Scoreboard *sb = nullptr) : sb(sb) {
+            iterator(BasicScoreboard *sb = nullptr) : sb(sb) {
                 load_next();
             }
 
@@ -122,6 +535,11 @@ namespace IA {
             return iterator();
         }
     };
+
+    using Scoreboard = BasicScoreboard<NullStats>;
+
+    extern template class BasicScoreboard<NullStats>;
+    extern template class BasicScoreboard<CollectStats>;
 } // namespace IA
 
 #endif /* IAScoreboard_hpp */
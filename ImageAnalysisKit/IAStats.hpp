@@ -0,0 +1,136 @@
+//
+//  IAStats.hpp
+//  ImageAnalysisKit
+//
+//  Created by Rob Menke on 10/18/26.
+//  Copyright © 2026 Rob Menke. All rights reserved.
+//
+
+#ifndef IAStats_hpp
+#define IAStats_hpp
+
+#include <chrono>
+
+namespace IA {
+    /*!
+     * @abstract Counters describing one analysis.
+     * @discussion Times are in seconds.
+     */
+    struct RunStats {
+        unsigned long edge_pixels          = 0;     // pixels queued for voting
+        unsigned long votes                = 0;     // votes cast
+        unsigned long votes_rejected       = 0;     // votes that failed the Poisson test
+        unsigned long increments           = 0;     // accumulator cells incremented by votes
+        unsigned long channel_scans        = 0;     // calls to scan_channel
+        unsigned long candidates           = 0;     // point sets found by scan_channel
+        unsigned long candidates_discarded = 0;     // point sets not reported as segments
+        unsigned long points_unvoted       = 0;     // votes withdrawn
+        unsigned long stale_entries        = 0;     // queue entries no longer pending
+        unsigned long raw_segments         = 0;     // segments before postprocessing
+        unsigned long segments             = 0;     // segments after postprocessing
+        unsigned long corners              = 0;     // corners found between segments
+
+        double setup_time       = 0;    // thresholding and queueing the image
+        double vote_time        = 0;    // voting and scanning channels
+        double postprocess_time = 0;    // fusing segments
+        double region_time      = 0;    // finding and sorting regions
+
+        RunStats &operator +=(const RunStats &rhs) {
+            edge_pixels          += rhs.edge_pixels;
+            votes                += rhs.votes;
+            votes_rejected       += rhs.votes_rejected;
+            increments           += rhs.increments;
+            channel_scans        += rhs.channel_scans;
+            candidates           += rhs.candidates;
+            candidates_discarded += rhs.candidates_discarded;
+            points_unvoted       += rhs.points_unvoted;
+            stale_entries        += rhs.stale_entries;
+            raw_segments         += rhs.raw_segments;
+            segments             += rhs.segments;
+            corners              += rhs.corners;
+
+            setup_time       += rhs.setup_time;
+            vote_time        += rhs.vote_time;
+            postprocess_time += rhs.postprocess_time;
+            region_time      += rhs.region_time;
+
+            return *this;
+        }
+    };
+
+    using stat_counter = unsigned long RunStats::*;
+    using stat_timer   = double RunStats::*;
+
+    /*!
+     * @abstract A statistics policy that records nothing.
+     * @discussion Every operation is an empty inline function, so an
+     *   analysis instantiated with this policy compiles to the same
+     *   code as one with no statistics at all.
+     */
+    struct NullStats {
+        void add(stat_counter, unsigned long = 1) { }
+        void add(const RunStats &) { }
+        void set(stat_counter, unsigned long) { }
+        void clear() { }
+
+        RunStats get() const {
+            return RunStats { };
+        }
+
+        struct scoped_timer {
+            scoped_timer(NullStats &, stat_timer) { }
+        };
+    };
+
+    /*!
+     * @abstract A statistics policy that records every counter.
+     */
+    class CollectStats {
+        RunStats data;
+
+    public:
+        void add(stat_counter field, unsigned long n = 1) {
+            data.*field += n;
+        }
+
+        void add(const RunStats &stats) {
+            data += stats;
+        }
+
+        void set(stat_counter field, unsigned long n) {
+            data.*field = n;
+        }
+
+        void clear() {
+            data = RunStats { };
+        }
+
+        const RunStats &get() const {
+            return data;
+        }
+
+        /*!
+         * @abstract Add the time spent in a scope to a timer.
+         */
+        class scoped_timer {
+            using clock = std::chrono::steady_clock;
+
+            CollectStats &stats;
+            const stat_timer field;
+            const clock::time_point start = clock::now();
+
+        public:
+            scoped_timer(CollectStats &stats, stat_timer field) : stats(stats), field(field) { }
+
+            scoped_timer(const scoped_timer &) = delete;
+            scoped_timer &operator =(const scoped_timer &) = delete;
+
+            ~scoped_timer() {
+                const std::chrono::duration<double> elapsed = clock::now() - start;
+                stats.data.*field += elapsed.count();
+            }
+        };
+    };
+}
+
+#endif /* IAStats_hpp */
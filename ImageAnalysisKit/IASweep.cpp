@@ -0,0 +1,109 @@
+//
+//  IASweep.cpp
+//  ImageAnalysisKit
+//
+//  Created by Rob Menke on 10/18/26.
+//  Copyright © 2026 Rob Menke. All rights reserved.
+//
+
+#include "IASweep.hpp"
+#include "IAContext.hpp"
+#include "IATiledContext.hpp"
+
+#include <dispatch/dispatch.h>
+
+#include <exception>
+
+namespace IA {
+    /*!
+     * @abstract The state shared by the workers of a sweep.
+     * @tparam Result The type of a single variant's result.
+     * @tparam Shared A function analyzing a variant with a @c Context
+     *   and the shared edge list.
+     * @tparam Tiled A function analyzing a variant with a @c
+     *   TiledContext.
+     */
+    template <class Result, class Shared, class Tiled>
+    struct Sweep {
+        const vImage_Buffer * const image;
+        const std::vector<UserParameters> &params;
+        Shared shared;
+        Tiled tiled;
+
+        std::vector<MemoryPlan> plans;
+        edge_list edges;
+
+        std::vector<Result> results;
+        std::vector<std::exception_ptr> errors;
+
+        Sweep(const vImage_Buffer *image, const std::vector<UserParameters> &params, Shared shared, Tiled tiled) : image(image), params(params), shared(shared), tiled(tiled), results(params.size()), errors(params.size()) {
+            bool sharing = false;
+
+            plans.reserve(params.size());
+
+            for (const auto &param : params) {
+                plans.push_back(plan_memory(image->height, image->width, param));
+                sharing = sharing || !is_tiled(plans.back());
+            }
+
+            if (sharing) edges = find_edges(image);
+        }
+
+        bool is_tiled(const MemoryPlan &plan) const {
+            return plan.tile_height < image->height || plan.tile_width < image->width;
+        }
+
+        void run(std::size_t i) {
+            trace::span span { "variant" };
+
+            try {
+                if (is_tiled(plans[i])) {
+                    TiledContext context { image->height, image->width, params[i] };
+                    results[i] = tiled(context);
+                }
+                else {
+                    Context context { image->height, image->width, params[i], plans[i].resolution };
+                    results[i] = shared(context, &edges);
+                }
+            }
+            catch (...) {
+                errors[i] = std::current_exception();
+            }
+        }
+
+        static void worker(void *context, std::size_t i) {
+            static_cast<Sweep *>(context)->run(i);
+        }
+
+        std::vector<Result> operator ()() {
+            dispatch_apply_f(params.size(), dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), this, worker);
+
+            for (const auto &error : errors) {
+                if (error) std::rethrow_exception(error);
+            }
+
+            return std::move(results);
+        }
+    };
+
+    template <class Result, class Shared, class Tiled>
+    static std::vector<Result> sweep(const vImage_Buffer *image, const std::vector<UserParameters> &params, Shared shared, Tiled tiled) {
+        return Sweep<Result, Shared, Tiled> { image, params, shared, tiled }();
+    }
+
+    std::vector<std::vector<segment_t>> sweep_segments(const vImage_Buffer *image, const std::vector<UserParameters> &params) {
+        return sweep<std::vector<segment_t>>(image, params, [image] (Context &context, const edge_list *edges) {
+            return context.find_segments(image, edges);
+        }, [image] (TiledContext &context) {
+            return context.find_segments(image);
+        });
+    }
+
+    std::vector<std::vector<Region>> sweep_regions(const vImage_Buffer *image, const std::vector<UserParameters> &params) {
+        return sweep<std::vector<Region>>(image, params, [image] (Context &context, const edge_list *edges) {
+            return context.find_regions(image, edges);
+        }, [image] (TiledContext &context) {
+            return context.find_regions(image);
+        });
+    }
+}
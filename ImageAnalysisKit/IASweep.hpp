@@ -0,0 +1,47 @@
+//
+//  IASweep.hpp
+//  ImageAnalysisKit
+//
+//  Created by Rob Menke on 10/18/26.
+//  Copyright © 2026 Rob Menke. All rights reserved.
+//
+
+#ifndef IASweep_hpp
+#define IASweep_hpp
+
+#include "IABase.hpp"
+#include "IAPolyline.hpp"
+
+#include <vector>
+
+namespace IA {
+    /*!
+     * @abstract Analyze one image with many sets of parameters.
+     *
+     * @discussion Meant for tuning the parameters for a new book.  The
+     *   image is scanned for edge pixels once, and the variants are
+     *   analyzed in parallel, each with its own accumulator and status
+     *   map but sharing the read-only image and edge list.
+     *
+     *   A variant that must be tiled, because of the size of the image
+     *   or its @c tileSize or @c memoryBudget parameters, is analyzed
+     *   exactly as by a @c TiledContext and does not share the scan.
+     *
+     * @param image The image to analyze, in Planar8 format.
+     * @param params The parameter sets.
+     * @return The segments found with each parameter set, in the same
+     *   order as @p params.
+     * @throw The first exception thrown by any variant, after all have
+     *   finished.
+     */
+    std::vector<std::vector<segment_t>> sweep_segments(const vImage_Buffer *image, const std::vector<UserParameters> &params);
+
+    /*!
+     * @abstract Analyze one image with many sets of parameters.
+     * @return The regions found with each parameter set.
+     * @see sweep_segments
+     */
+    std::vector<std::vector<Region>> sweep_regions(const vImage_Buffer *image, const std::vector<UserParameters> &params);
+}
+
+#endif /* IASweep_hpp */
@@ -0,0 +1,222 @@
+//
+//  IATiledContext.cpp
+//  ImageAnalysisKit
+//
+//  Created by Rob Menke on 10/18/26.
+//  Copyright © 2026 Rob Menke. All rights reserved.
+//
+
+#include "IATiledContext.hpp"
+#include "IAPolyline.hpp"
+#include "IAPostprocess.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <utility>
+
+namespace IA {
+    // The largest extent a scoreboard can handle, and the tile size
+    // used for larger images when none is given.
+
+    static constexpr vImagePixelCount max_extent   = UINT16_MAX;
+    static constexpr vImagePixelCount default_tile = 4096;
+    static constexpr vImagePixelCount min_tile     = 256;
+
+    // The greatest number of times the rho and angular resolutions
+    // may be halved to save memory, and the fewest angles allowed.
+
+    static constexpr unsigned max_rho_shift = 2;
+    static constexpr unsigned max_angle_shift = 2;
+    static constexpr vImagePixelCount min_angles = 256;
+
+    static vImagePixelCount tile_overlap(vImagePixelCount tile, const UserParameters &param) {
+        const vImagePixelCount overlap = std::max(param.minSegmentLength, 0) + 2 * std::max(param.maxGap, 0) + std::max<int>(param.channelWidth, 3);
+        return std::min(overlap, tile / 2);
+    }
+
+    /*!
+     * @abstract Compute the positions of the tiles along an axis.
+     * @discussion The last tile is moved back to end at the edge of
+     *   the image, so that every tile has the same size and one
+     *   scoreboard serves them all.
+     */
+    static std::vector<vImagePixelCount> tile_origins(vImagePixelCount extent, vImagePixelCount tile, vImagePixelCount overlap) {
+        std::vector<vImagePixelCount> origins { 0 };
+
+        while (origins.back() + tile < extent) {
+            origins.push_back(std::min(origins.back() + tile - overlap, extent - tile));
+        }
+
+        return origins;
+    }
+
+    std::size_t border_mask_footprint(vImagePixelCount height, vImagePixelCount width) {
+        return height * width * (4 * sizeof(float) + sizeof(float) + sizeof(uint8_t));
+    }
+
+    static MemoryPlan make_plan(vImagePixelCount height, vImagePixelCount width, const UserParameters &param, vImagePixelCount tile, unsigned rho_shift, unsigned angle_shift = 0) {
+        MemoryPlan plan;
+
+        plan.tile_height = std::min(height, tile);
+        plan.tile_width  = std::min(width,  tile);
+
+        const auto angles = angle_count(std::ceil(std::hypot(plan.tile_width, plan.tile_height)), param.angleCount);
+
+        plan.resolution.rho_shift = rho_shift;
+        plan.resolution.angles    = std::max(angles >> angle_shift, std::min(angles, min_angles));
+        plan.bytes                = Context::footprint(plan.tile_height, plan.tile_width, param, plan.resolution);
+
+        // The buffer that holds a tile read from a row source.
+
+        if (plan.tile_height < height || plan.tile_width < width) {
+            plan.bytes += plan.tile_height * plan.tile_width;
+        }
+
+        plan.bytes += border_mask_footprint(height, width);
+
+        return plan;
+    }
+
+    MemoryPlan plan_memory(vImagePixelCount height, vImagePixelCount width, const UserParameters &param) {
+        vImagePixelCount tile;
+
+        if (param.tileSize > 0) {
+            tile = std::min(std::max<vImagePixelCount>(param.tileSize, min_tile), max_extent);
+        }
+        else {
+            tile = (height > max_extent || width > max_extent) ? default_tile : std::max(height, width);
+        }
+
+        auto best = make_plan(height, width, param, tile, 0);
+
+        const auto budget = static_cast<std::size_t>(std::max<SInt64>(param.memoryBudget, 0));
+        if (budget == 0 || best.bytes <= budget) return best;
+
+        // Coarsening rho shrinks only the accumulator but costs little
+        // accuracy, so try it before each reduction of the tile size,
+        // followed by coarsening the angles, which costs more.
+        // Smaller tiles do not always help, since the accumulator of a
+        // smaller tile has finer rho resolution, so keep the smallest
+        // plan seen in case none fits.
+
+        for (;;) {
+            for (unsigned rho_shift = 0; rho_shift <= max_rho_shift; ++rho_shift) {
+                const auto plan = make_plan(height, width, param, tile, rho_shift);
+
+                if (plan.bytes <= budget) return plan;
+                if (plan.bytes < best.bytes) best = plan;
+            }
+
+            for (unsigned angle_shift = 1; angle_shift <= max_angle_shift; ++angle_shift) {
+                const auto plan = make_plan(height, width, param, tile, max_rho_shift, angle_shift);
+
+                if (plan.bytes <= budget) return plan;
+                if (plan.bytes < best.bytes) best = plan;
+            }
+
+            if (tile <= min_tile) break;
+
+            tile = std::max(tile / 2, min_tile);
+        }
+
+        return best;
+    }
+
+    template <class Stats>
+    BasicTiledContext<Stats>::BasicTiledContext(vImagePixelCount height, vImagePixelCount width, const UserParameters &param) :
+        param(param), plan(plan_memory(height, width, param)), height(height), width(width),
+        tile_height(plan.tile_height), tile_width(plan.tile_width),
+        rows(tile_origins(height, tile_height, tile_overlap(tile_height, param))),
+        columns(tile_origins(width, tile_width, tile_overlap(tile_width, param))),
+        context(tile_height, tile_width, param, plan.resolution) {
+    }
+
+    template <class Stats>
+    void BasicTiledContext<Stats>::begin_tile(std::size_t index) {
+        if (!monitor) return;
+
+        const double tiles = rows.size() * columns.size();
+
+        monitor->check();
+        monitor->set_range(index / tiles, 1 / tiles);
+    }
+
+    template <class Stats>
+    void BasicTiledContext<Stats>::analyze_tile(const vImage_Buffer *image, point_t origin, std::vector<segment_t> &segments) {
+        trace::span span { "tile" };
+
+        const auto found = context.find_segments(image, origin);
+        segments.insert(segments.end(), found.begin(), found.end());
+
+        stopped_early = stopped_early || context.partial();
+        stats.add(context.statistics());
+    }
+
+    template <class Stats>
+    std::vector<segment_t> BasicTiledContext<Stats>::merge(std::vector<segment_t> &segments, point_t origin) {
+        // A single tile has already been postprocessed by the context.
+        // Otherwise fuse the pieces of segments that cross tiles and
+        // the duplicates found in the overlaps.
+
+        if (tiled()) {
+            typename Stats::scoped_timer timer { stats, &RunStats::postprocess_time };
+            trace::span span { "postprocess" };
+
+            if (single_precision(origin)) {
+                postprocess_in<float>(segments);
+            }
+            else {
+                postprocess_in<double>(segments);
+            }
+
+            stats.set(&RunStats::segments, segments.size());
+        }
+
+        return std::move(segments);
+    }
+
+    template <class Stats>
+    std::vector<Region> BasicTiledContext<Stats>::make_regions(const std::vector<segment_t> &segments, point_t origin) {
+        std::vector<Region> regions;
+
+        typename Stats::scoped_timer timer { stats, &RunStats::region_time };
+
+        if (single_precision(origin)) {
+            stats.add(&RunStats::corners, find_sorted_regions<float>(segments, regions, param.maxGap));
+        }
+        else {
+            stats.add(&RunStats::corners, find_sorted_regions<double>(segments, regions, param.maxGap));
+        }
+
+        return regions;
+    }
+
+    template <class Stats>
+    std::vector<segment_t> BasicTiledContext<Stats>::find_segments(const vImage_Buffer *image, point_t origin) {
+        if (image->height != height || image->width != width) {
+            throw VImageException(kvImageBufferSizeMismatch);
+        }
+
+        std::vector<segment_t> segments;
+
+        stopped_early = false;
+        stats.clear();
+
+        std::size_t index = 0;
+
+        for (const auto y0 : rows) {
+            for (const auto x0 : columns) {
+                begin_tile(index++);
+
+                const auto roi = make_roi(*image, x0, y0, tile_width, tile_height);
+                analyze_tile(&roi, origin + point_t { static_cast<double>(x0), static_cast<double>(y0) }, segments);
+            }
+        }
+
+        return merge(segments, origin);
+    }
+
+    template class BasicTiledContext<NullStats>;
+    template class BasicTiledContext<CollectStats>;
+}
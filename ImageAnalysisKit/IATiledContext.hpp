@@ -0,0 +1,308 @@
+//
+//  IATiledContext.hpp
+//  ImageAnalysisKit
+//
+//  Created by Rob Menke on 10/18/26.
+//  Copyright © 2026 Rob Menke. All rights reserved.
+//
+
+#ifndef IATiledContext_hpp
+#define IATiledContext_hpp
+
+#include "IABase.hpp"
+#include "IAContext.hpp"
+#include "IAManagedBuffer.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace IA {
+    /*!
+     * @abstract How an image will be analyzed, and the memory that
+     *   analysis needs.
+     */
+    struct MemoryPlan {
+        vImagePixelCount tile_height, tile_width;   // the whole image if not tiled
+        Resolution resolution;                      // of the full-resolution accumulator
+        std::size_t bytes;                          // the estimated peak footprint
+    };
+
+    /*!
+     * @abstract Decide how to analyze an image within the memory
+     *   budget given in the parameters.
+     * @discussion If the analysis would need more than @c
+     *   memoryBudget bytes, the plan first coarsens the rho
+     *   resolution of the accumulator, then its angular resolution
+     *   (down to 256 angles), then divides the image into
+     *   successively smaller tiles, until it fits.  A budget too small
+     *   for even the smallest tiles yields the smallest plan rather
+     *   than an error.  The border mask is part of the estimate but
+     *   not reduced by any plan, so it is always charged against
+     *   the budget in full.
+     * @return The plan, including the estimated peak memory.  Without
+     *   a budget this is simply the estimate for the parameters.
+     */
+    MemoryPlan plan_memory(vImagePixelCount height, vImagePixelCount width, const UserParameters &param);
+
+    /*!
+     * @abstract Estimate the memory held by the intermediate buffers
+     *   of IABuffer's border mask.
+     * @discussion The L*a*b* image (16 bytes per pixel), its alpha
+     *   channel (4), and the Planar8 mask (1).  They cover the whole
+     *   page, so tiling does not reduce them.
+     * @return The number of bytes.
+     */
+    std::size_t border_mask_footprint(vImagePixelCount height, vImagePixelCount width);
+
+    /*!
+     * @abstract An analysis context for images of any size.
+     *
+     * @discussion The scoreboard stores coordinates and votes in 16
+     *   bits, and its status map and accumulator grow with the area
+     *   and diagonal of the image.  A tiled context divides the image
+     *   into overlapping tiles small enough for one scoreboard,
+     *   analyzes them one at a time through a single @c Context, and
+     *   fuses the pieces of segments that cross tile boundaries.
+     *   Memory use is therefore bounded by the tile size regardless of
+     *   the size of the image, and coordinates are carried in page
+     *   space as doubles, which are exact far beyond 32 bits.
+     *
+     *   The tiles overlap by more than the minimum segment length, so
+     *   each piece of a segment that crosses a tile boundary is itself
+     *   long enough to be reported; the pieces are then fused by
+     *   @c merge into the whole segment.
+     *
+     *   Images no larger than 65535 pixels in either dimension are
+     *   analyzed as a single tile unless the @c tileSize parameter
+     *   asks otherwise, in which case a tiled context behaves exactly
+     *   like a @c Context.
+     *
+     *   Images are also tiled, and the accumulator resolution
+     *   coarsened, as needed to respect the @c memoryBudget
+     *   parameter; see @c plan_memory.
+     *
+     *   The limits in the parameters apply to each tile separately.
+     *
+     *   A tiled context is not thread-safe; use one per thread.
+     *
+     * @tparam Stats The statistics policy; see @c BasicScoreboard.
+     */
+    template <class Stats>
+    class BasicTiledContext {
+        const UserParameters param;
+        const MemoryPlan plan;
+
+        const vImagePixelCount height, width;
+        const vImagePixelCount tile_height, tile_width;
+
+        // The positions of the tiles along each axis.
+
+        const std::vector<vImagePixelCount> rows, columns;
+
+        BasicContext<Stats> context;
+
+        // The tile buffer used when reading from a row source; created
+        // on first use.
+
+        std::unique_ptr<managed_buffer<uint8_t>> tile;
+
+        bool stopped_early = false;
+
+        Monitor *monitor = nullptr;
+
+        // The counters summed over the tiles.
+
+        Stats stats;
+
+        void begin_tile(std::size_t index);
+        void analyze_tile(const vImage_Buffer *image, point_t origin, std::vector<segment_t> &segments);
+        std::vector<segment_t> merge(std::vector<segment_t> &segments, point_t origin);
+
+        // Whether the geometry of the whole image, whose first pixel
+        // is at origin, is carried out in single precision.
+
+        bool single_precision(point_t origin) const {
+            return !param.doubleGeometry && single_precision_suffices(std::max(origin.x + width, origin.y + height));
+        }
+
+    public:
+        BasicTiledContext(vImagePixelCount height, vImagePixelCount width, const UserParameters &param);
+
+        BasicTiledContext(const BasicTiledContext &) = delete;
+        BasicTiledContext &operator =(const BasicTiledContext &) = delete;
+
+        /*!
+         * @abstract Whether the image is divided into more than one
+         *   tile.
+         */
+        bool tiled() const {
+            return rows.size() > 1 || columns.size() > 1;
+        }
+
+        /*!
+         * @abstract Let a monitor observe and cancel the analysis.
+         * @discussion The progress of each tile is reported as its
+         *   share of the whole image.
+         * @see BasicScoreboard::set_monitor
+         */
+        void set_monitor(Monitor *monitor) {
+            this->monitor = monitor;
+            context.set_monitor(monitor);
+        }
+
+        /*!
+         * @abstract Start each analysis from the segments of a similar
+         *   image.
+         * @discussion Every tile is given every hint; those that do not
+         *   cross a tile cost only an empty scan.
+         * @see BasicContext::set_hints
+         */
+        void set_hints(std::vector<segment_t> hints) {
+            context.set_hints(std::move(hints));
+        }
+
+        /*!
+         * @abstract Whether the analysis of any tile in the last image
+         *   stopped at one of the limits set in the parameters.
+         */
+        bool partial() const {
+            return stopped_early;
+        }
+
+        /*!
+         * @abstract The counters recorded during the last analysis,
+         *   summed over the tiles.
+         * @discussion Always zero under the @c NullStats policy.
+         */
+        RunStats statistics() const {
+            return stats.get();
+        }
+
+        /*!
+         * @abstract Find the line segments in an image held in memory.
+         * @discussion Each tile is a view of @p image; no pixels are
+         *   copied.
+         * @param image The image to analyze, in Planar8 format.  It
+         *   must have the dimensions given when the context was
+         *   created.
+         * @param origin If @p image is a view of a region of a larger
+         *   buffer, the position of the region.
+         * @return The segments after postprocessing.
+         */
+        std::vector<segment_t> find_segments(const vImage_Buffer *image, point_t origin = point_t { 0, 0 });
+
+        /*!
+         * @abstract Find the convex regions in an image held in memory.
+         * @see find_segments
+         */
+        std::vector<Region> find_regions(const vImage_Buffer *image, point_t origin = point_t { 0, 0 }) {
+            return make_regions(find_segments(image, origin), origin);
+        }
+
+        /*!
+         * @abstract Find the convex regions formed by segments already
+         *   found.
+         * @discussion Gives the same regions as @c find_regions would
+         *   have for the analysis that found the segments, so that an
+         *   image need not be analyzed twice for both.
+         * @param origin As given to @c find_segments.
+         */
+        std::vector<Region> make_regions(const std::vector<segment_t> &segments, point_t origin = point_t { 0, 0 });
+
+        /*!
+         * @abstract Find the line segments in an image, passing each
+         *   to a function as it is found.
+         * @discussion A single tile is enumerated by the context as it
+         *   votes.  Segments that may cross tiles are only known once
+         *   every tile has been analyzed and merged, so a tiled image
+         *   is enumerated afterward, and its segments are always
+         *   fused.
+         * @see BasicContext::enumerate_segments
+         */
+        template <class Function>
+        bool enumerate_segments(const vImage_Buffer *image, bool fused, Function function) {
+            if (!tiled()) {
+                if (image->height != height || image->width != width) {
+                    throw VImageException(kvImageBufferSizeMismatch);
+                }
+
+                stats.clear();
+
+                const bool finished = context.enumerate_segments(image, fused, function);
+
+                stopped_early = context.partial();
+                stats.add(context.statistics());
+
+                return finished;
+            }
+
+            const auto segments = find_segments(image);
+
+            for (std::size_t index = 0; index < segments.size(); ++index) {
+                if (!function(index, segments[index])) return false;
+            }
+
+            return true;
+        }
+
+        /*!
+         * @abstract Find the line segments in an image read a row at a
+         *   time.
+         * @discussion Only one tile of the image is held in memory.
+         *   The source is asked for the part of each row that lies in
+         *   the current tile, tile by tile, so rows in the overlap
+         *   between tiles (and, when the image is more than one tile
+         *   wide, every row) are read more than once.
+         * @param source A function <code>void (vImagePixelCount y,
+         *   vImagePixelCount x, vImagePixelCount count, uint8_t
+         *   *pixels)</code> that stores the @p count Planar8 pixels of
+         *   row @p y starting at column @p x into @p pixels.
+         * @return The segments after postprocessing.
+         */
+        template <class Source>
+        std::vector<segment_t> read_segments(Source source) {
+            if (!tile) tile.reset(new managed_buffer<uint8_t>(tile_height, tile_width));
+
+            const managed_buffer<uint8_t> &buffer = *tile;
+
+            std::vector<segment_t> segments;
+
+            stopped_early = false;
+            stats.clear();
+
+            std::size_t index = 0;
+
+            for (const auto y0 : rows) {
+                for (const auto x0 : columns) {
+                    begin_tile(index++);
+
+                    for (vImagePixelCount y = 0; y < tile_height; ++y) {
+                        source(y0 + y, x0, tile_width, buffer[y]);
+                    }
+
+                    analyze_tile(&buffer, point_t { static_cast<double>(x0), static_cast<double>(y0) }, segments);
+                }
+            }
+
+            return merge(segments, point_t { 0, 0 });
+        }
+
+        /*!
+         * @abstract Find the convex regions in an image read a row at a
+         *   time.
+         * @see read_segments
+         */
+        template <class Source>
+        std::vector<Region> read_regions(Source source) {
+            return make_regions(read_segments(source), point_t { 0, 0 });
+        }
+    };
+
+    using TiledContext = BasicTiledContext<NullStats>;
+
+    extern template class BasicTiledContext<NullStats>;
+    extern template class BasicTiledContext<CollectStats>;
+}
+
+#endif /* IATiledContext_hpp */
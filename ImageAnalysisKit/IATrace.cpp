@@ -0,0 +1,140 @@
+//
+//  IATrace.cpp
+//  ImageAnalysisKit
+//
+//  Created by Rob Menke on 10/18/26.
+//  Copyright © 2026 Rob Menke. All rights reserved.
+//
+
+#include "IATrace.hpp"
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace IA {
+    namespace trace {
+        std::atomic<bool> enabled { false };
+
+        // The number of events each thread keeps; older events are
+        // overwritten.
+
+        static constexpr std::size_t ring_capacity = 1 << 14;
+
+        struct event {
+            const char *name;
+            uint64_t begin, end;
+        };
+
+        struct ring {
+            const unsigned tid;
+
+            // Only the owning thread writes, so the lock is
+            // uncontended except while the rings are being dumped.
+
+            std::mutex mutex;
+            std::vector<event> events;
+            std::size_t next = 0;
+
+            explicit ring(unsigned tid) : tid(tid) {
+                events.reserve(ring_capacity);
+            }
+
+            void push(const event &e) {
+                std::lock_guard<std::mutex> lock { mutex };
+
+                if (events.size() < ring_capacity) {
+                    events.push_back(e);
+                }
+                else {
+                    events[next] = e;
+                    next = (next + 1) % ring_capacity;
+                }
+            }
+        };
+
+        // The registry holds a reference to every ring so that the
+        // events of threads that have exited can still be dumped.
+
+        static std::mutex &registry_mutex() {
+            static std::mutex mutex;
+            return mutex;
+        }
+
+        static std::vector<std::shared_ptr<ring>> &registry() {
+            static std::vector<std::shared_ptr<ring>> rings;
+            return rings;
+        }
+
+        static ring &local_ring() {
+            thread_local std::shared_ptr<ring> local = [] {
+                std::lock_guard<std::mutex> lock { registry_mutex() };
+
+                auto &rings = registry();
+                rings.push_back(std::make_shared<ring>(static_cast<unsigned>(rings.size() + 1)));
+
+                return rings.back();
+            }();
+
+            return *local;
+        }
+
+        uint64_t now() {
+            using clock = std::chrono::steady_clock;
+
+            static const clock::time_point origin = clock::now();
+
+            // Offset by one so that zero can mean "not recording."
+
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - origin).count() + 1;
+        }
+
+        void record(const char *name, uint64_t begin, uint64_t end) {
+            local_ring().push(event { name, begin, end });
+        }
+
+        void clear() {
+            std::lock_guard<std::mutex> lock { registry_mutex() };
+
+            for (auto &r : registry()) {
+                std::lock_guard<std::mutex> ring_lock { r->mutex };
+                r->events.clear();
+                r->next = 0;
+            }
+        }
+
+        std::string json() {
+            std::string result = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+            const int pid = getpid();
+            bool first = true;
+
+            std::lock_guard<std::mutex> lock { registry_mutex() };
+
+            for (auto &r : registry()) {
+                std::lock_guard<std::mutex> ring_lock { r->mutex };
+
+                for (const auto &e : r->events) {
+                    char buffer[256];
+
+                    // Span names are string literals without quotes or
+                    // backslashes, so they need no escaping.
+
+                    snprintf(buffer, sizeof(buffer), "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                             first ? "" : ",", e.name, pid, r->tid, e.begin / 1000.0, (e.end - e.begin) / 1000.0);
+
+                    result += buffer;
+                    first = false;
+                }
+            }
+
+            result += "]}";
+
+            return result;
+        }
+    }
+}
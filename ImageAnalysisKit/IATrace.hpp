@@ -0,0 +1,78 @@
+//
+//  IATrace.hpp
+//  ImageAnalysisKit
+//
+//  Created by Rob Menke on 10/18/26.
+//  Copyright © 2026 Rob Menke. All rights reserved.
+//
+
+#ifndef IATrace_hpp
+#define IATrace_hpp
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace IA {
+    /*!
+     * @abstract Opt-in timeline tracing.
+     *
+     * @discussion While tracing is enabled, each @c span records the
+     *   interval it was alive into a ring buffer owned by the current
+     *   thread, so recording never contends with other threads.  The
+     *   rings of all threads, including threads that have exited, can
+     *   be dumped as a Chrome trace (loadable in chrome://tracing or
+     *   Perfetto) for a single analysis or a whole batch.
+     *
+     *   When tracing is disabled a span costs one relaxed atomic load.
+     */
+    namespace trace {
+        extern std::atomic<bool> enabled;
+
+        /*!
+         * @abstract The current time in nanoseconds since tracing was
+         *   first used.
+         */
+        uint64_t now();
+
+        /*!
+         * @abstract Record a completed interval on the current thread.
+         * @param name The name of the interval.  It must have static
+         *   storage duration; only the pointer is kept.
+         * @param begin The start time, as returned by @c now().
+         * @param end The end time, as returned by @c now().
+         */
+        void record(const char *name, uint64_t begin, uint64_t end);
+
+        /*!
+         * @abstract Discard the events recorded so far on all threads.
+         */
+        void clear();
+
+        /*!
+         * @abstract Format the events recorded on all threads in the
+         *   Chrome trace event format.
+         */
+        std::string json();
+
+        /*!
+         * @abstract Record the lifetime of a scope.
+         */
+        class span {
+            const char * const name;
+            const uint64_t begin;
+
+        public:
+            explicit span(const char *name) : name(name), begin(enabled.load(std::memory_order_relaxed) ? now() : 0) { }
+
+            span(const span &) = delete;
+            span &operator =(const span &) = delete;
+
+            ~span() {
+                if (begin) record(name, begin, now());
+            }
+        };
+    }
+}
+
+#endif /* IATrace_hpp */
@@ -243,6 +243,26 @@ namespace cf {
         return get<T>(static_cast<CFNumberRef>(_get(dictionary, key)));
     }
 
+    /*!
+     * @abstract Return a value from a dictionary given its key, or a
+     *   default value if the key is absent.
+     * @tparam T The type to return.
+     * @param dictionary The dictionary.
+     * @param key The key.
+     * @param default_value The value to return if the key does not
+     *   exist in the dictionary.
+     * @return A value of type T.
+     */
+    template <typename T> static inline std::enable_if_t<cf_typeinfo<T>::is_number, T> get(CFDictionaryRef dictionary, CFStringRef key, T default_value) {
+        CHECK_CF_TYPE(dictionary, CFDictionary);
+
+        CFTypeRef value;
+        if (!CFDictionaryGetValueIfPresent(dictionary, key, &value)) {
+            return default_value;
+        }
+        return get<T>(static_cast<CFNumberRef>(value));
+    }
+
     /*!
      * @discussion Use this function for exceptions that are
      *   subclasses of @c std::exception.
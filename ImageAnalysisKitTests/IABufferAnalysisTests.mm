@@ -11,9 +11,12 @@
 #import <simd/simd.h>
 
 #import "IABufferAnalysis.h"
+#import "IAContext.hpp"
+#import "IATiledContext.hpp"
 #import "IAPolyline.hpp"
 #import "IAScoreboard.hpp"
 
+#include <algorithm>
 #include <array>
 #include <iostream>
 #include <vector>
@@ -22,6 +25,61 @@
 
 static auto urbg = std::default_random_engine{std::random_device{}()};
 
+// An edge map for the tests to analyze.
+
+struct TestPage {
+    const vImagePixelCount width, height;
+    std::vector<uint8_t> pixels;
+
+    TestPage(vImagePixelCount width, vImagePixelCount height) : width(width), height(height), pixels(width * height, 0) { }
+
+    uint8_t &at(vImagePixelCount x, vImagePixelCount y) {
+        return pixels[y * width + x];
+    }
+
+    vImage_Buffer buffer() {
+        return { pixels.data(), height, width, width };
+    }
+};
+
+// The 128×128 page most tests analyze: a frame from (20, 20) to
+// (100, 100), moved down and right by shift, with its diagonal if
+// asked for.
+
+static TestPage frame_page(bool diagonal = false, vImagePixelCount shift = 0) {
+    TestPage page { 128, 128 };
+
+    for (vImagePixelCount i = 20 + shift; i <= 100 + shift; ++i) {
+        page.at(i, 20 + shift) = page.at(i, 100 + shift) = 0xff;
+        page.at(20 + shift, i) = page.at(100 + shift, i) = 0xff;
+
+        if (diagonal) page.at(i, i) = 0xff;
+    }
+
+    return page;
+}
+
+// A 128×96 page with two horizontal lines, at y = 20 and y = 80.
+
+static TestPage two_line_page() {
+    TestPage page { 128, 96 };
+
+    for (vImagePixelCount x = 10; x < 118; ++x) {
+        page.at(x, 20) = page.at(x, 80) = 0xff;
+    }
+
+    return page;
+}
+
+// The outcome of an asynchronous analysis.
+
+struct AsyncResult {
+    dispatch_semaphore_t done = dispatch_semaphore_create(0);
+    NSArray *result = nil;
+    NSError *error = nil;
+    double progress = 0;
+};
+
 @interface IABufferAnalysisTests : XCTestCase
 
 @end
@@ -43,6 +101,16 @@ static auto urbg = std::default_random_engine{std::random_device{}()};
     XCTAssertEqual(names.count, 4);
 }
 
+- (void)testOptionalParameters {
+    NSArray<NSString *> *names = CFBridgingRelease(IACopyOptionalParameterNames());
+    XCTAssert([names containsObject:@"timeLimit"]);
+
+    IA::UserParameters param { (__bridge CFDictionaryRef)(@{@"sensitivity":@12, @"maxGap":@3, @"minSegmentLength":@10, @"channelWidth":@3, @"maxVotes":@50}) };
+
+    XCTAssertEqual(param.maxVotes, 50);
+    XCTAssertEqual(param.timeLimit, 0.0);
+}
+
 - (void)testExceptionNoParam {
     CFErrorRef cf_error = NULL;
     vImage_Buffer buffer;
@@ -161,6 +229,1011 @@ static auto urbg = std::default_random_engine{std::random_device{}()};
     for (__unused auto &segment : IA::Scoreboard(&buffer, param)) { }
 }
 
+- (void)testContextReuse {
+    uint8_t blank[16][16] = { };
+    uint8_t lines[16][16] = { };
+
+    for (int i = 0; i < 16; ++i) {
+        lines[3][i] = 0xff;
+    }
+
+    vImage_Buffer blankBuffer = {
+        blank, 16, 16, 16
+    };
+
+    vImage_Buffer linesBuffer = {
+        lines, 16, 16, 16
+    };
+
+    IA::UserParameters param { (__bridge CFDictionaryRef)(@{@"sensitivity":@12, @"maxGap":@3, @"minSegmentLength":@10, @"channelWidth":@3}) };
+
+    IA::Context context { 16, 16, param };
+
+    XCTAssertEqual(context.find_segments(&linesBuffer).size(), 1);
+    XCTAssertEqual(context.find_segments(&blankBuffer).size(), 0);
+    XCTAssertEqual(context.find_segments(&linesBuffer).size(), 1);
+
+    uint8_t small[8][8] = { };
+
+    vImage_Buffer smallBuffer = {
+        small, 8, 8, 8
+    };
+
+    XCTAssertThrows(context.find_segments(&smallBuffer));
+}
+
+- (void)testFlatResults {
+    uint8_t data[16][16] = { };
+
+    for (int i = 0; i < 16; ++i) {
+        data[3][i] = 0xff;
+    }
+
+    vImage_Buffer buffer = {
+        data, 16, 16, 16
+    };
+
+    NSDictionary<NSString *, id> *parameters = @{@"sensitivity":@12, @"maxGap":@3, @"minSegmentLength":@10, @"channelWidth":@3};
+
+    CFErrorRef cf_error = nullptr;
+    NSData *segments = CFBridgingRelease(IACreateSegmentData(&buffer, (__bridge CFDictionaryRef)(parameters), &cf_error));
+
+    XCTAssertNotNil(segments, @"error - %@", CFBridgingRelease(cf_error));
+    XCTAssertEqual(segments.length, 4 * sizeof(double));
+
+    if (segments.length == 4 * sizeof(double)) {
+        const double *s = static_cast<const double *>(segments.bytes);
+        XCTAssertEqualWithAccuracy(s[1], 3.0, 1.0);
+        XCTAssertEqualWithAccuracy(s[3], 3.0, 1.0);
+        XCTAssertEqualWithAccuracy(std::fabs(s[2] - s[0]), 15.0, 1.0);
+    }
+
+    IAAnalysisContextRef context = IAAnalysisContextCreate(16, 16, (__bridge CFDictionaryRef)(parameters), nullptr);
+    XCTAssert(context != nullptr);
+
+    XCTAssertEqual(IAAnalysisContextFindSegments(context, &buffer, nullptr), 1);
+    XCTAssertEqual(IAAnalysisContextGetResults(context, nullptr, 0), 1);
+
+    double values[4] = { };
+    XCTAssertEqual(IAAnalysisContextGetResults(context, values, 1), 1);
+    XCTAssertEqualWithAccuracy(values[1], 3.0, 1.0);
+
+    IAAnalysisContextRelease(context);
+}
+
+- (void)testEnumerateSegmentsEarlyStop {
+    uint8_t data[32][32] = { };
+
+    for (int i = 0; i < 32; ++i) {
+        data[4][i] = 0xff;
+        data[27][i] = 0xff;
+        data[i][4] = 0xff;
+        data[i][27] = 0xff;
+    }
+
+    vImage_Buffer buffer = {
+        data, 32, 32, 32
+    };
+
+    IA::UserParameters param { (__bridge CFDictionaryRef)(@{@"sensitivity":@12, @"maxGap":@3, @"minSegmentLength":@10, @"channelWidth":@3}) };
+
+    IA::Context context { 32, 32, param };
+
+    std::size_t count = 0;
+
+    XCTAssertTrue(context.enumerate_segments(&buffer, false, [&count] (std::size_t, const IA::segment_t &) {
+        ++count;
+        return true;
+    }));
+
+    XCTAssertGreaterThanOrEqual(count, 4);
+
+    count = 0;
+
+    XCTAssertFalse(context.enumerate_segments(&buffer, false, [&count] (std::size_t, const IA::segment_t &) {
+        return ++count < 2;
+    }));
+
+    XCTAssertEqual(count, 2);
+}
+
+- (void)testVoteLimit {
+    uint8_t data[64][64] = { };
+
+    std::uniform_int_distribution<int> coord(0, 63);
+
+    for (int i = 0; i < 512; ++i) {
+        data[coord(urbg)][coord(urbg)] = 0xff;
+    }
+
+    vImage_Buffer buffer = {
+        data, 64, 64, 64
+    };
+
+    IA::UserParameters limited { (__bridge CFDictionaryRef)(@{@"sensitivity":@12, @"maxGap":@3, @"minSegmentLength":@10, @"channelWidth":@3, @"maxVotes":@10}) };
+    IA::UserParameters unlimited { (__bridge CFDictionaryRef)(@{@"sensitivity":@12, @"maxGap":@3, @"minSegmentLength":@10, @"channelWidth":@3}) };
+
+    IA::Context limitedContext { 64, 64, limited };
+    limitedContext.find_segments(&buffer);
+    XCTAssertTrue(limitedContext.partial());
+
+    IA::Context unlimitedContext { 64, 64, unlimited };
+    unlimitedContext.find_segments(&buffer);
+    XCTAssertFalse(unlimitedContext.partial());
+}
+
+- (void)testPyramid {
+    auto page = frame_page();
+    vImage_Buffer buffer = page.buffer();
+
+    IA::UserParameters param { (__bridge CFDictionaryRef)(@{@"sensitivity":@12, @"maxGap":@4, @"minSegmentLength":@15, @"channelWidth":@3, @"pyramidLevels":@1}) };
+
+    IA::Context context { 128, 128, param };
+
+    auto regions = context.find_regions(&buffer);
+
+    XCTAssertEqual(regions.size(), 1);
+    if (regions.size()) {
+        XCTAssert(simd::all(simd::fabs(regions.front() - simd::double4{20, 20, 80, 80}) <= 2.0));
+    }
+}
+
+- (void)testRegionOfInterest {
+    static uint8_t data[128][128] = { };
+
+    for (int i = 10; i < 120; ++i) {
+        data[40][i] = 0xff;     // inside the region of interest
+        data[i][10] = 0xff;     // outside the region of interest
+    }
+
+    vImage_Buffer buffer = {
+        data, 128, 128, 128
+    };
+
+    NSDictionary<NSString *, id> *parameters = @{@"sensitivity":@12, @"maxGap":@2, @"minSegmentLength":@20, @"channelWidth":@3};
+
+    CFErrorRef cf_error = nullptr;
+    NSArray<NSArray<NSNumber *> *> *segments = CFBridgingRelease(IACreateSegmentArrayInRect(&buffer, CGRectMake(32, 24, 80, 32), (__bridge CFDictionaryRef)(parameters), &cf_error));
+
+    XCTAssertNotNil(segments, @"error - %@", cf_error);
+    XCTAssertEqual(segments.count, 1);
+
+    for (NSArray<NSNumber *> *segment in segments) {
+        XCTAssertEqualWithAccuracy(segment[1].doubleValue, 40, 1);
+        XCTAssertEqualWithAccuracy(segment[3].doubleValue, 40, 1);
+        XCTAssertGreaterThanOrEqual(MIN(segment[0].doubleValue, segment[2].doubleValue), 32);
+        XCTAssertLessThan(MAX(segment[0].doubleValue, segment[2].doubleValue), 112);
+    }
+
+    CFErrorRef roi_error = nullptr;
+    XCTAssertNil(CFBridgingRelease(IACreateSegmentArrayInRect(&buffer, CGRectMake(64, 64, 80, 32), (__bridge CFDictionaryRef)(parameters), &roi_error)));
+    XCTAssertNotNil(CFBridgingRelease(roi_error));
+}
+
+- (void)testTiledAnalysis {
+    constexpr vImagePixelCount width = 700, height = 300;
+
+    std::vector<uint8_t> data(width * height, 0);
+
+    for (vImagePixelCount x = 20; x < 680; ++x) {
+        data[150 * width + x] = 0xff;
+    }
+
+    vImage_Buffer buffer = {
+        data.data(), height, width, width
+    };
+
+    IA::UserParameters param { (__bridge CFDictionaryRef)(@{@"sensitivity":@12, @"maxGap":@2, @"minSegmentLength":@20, @"channelWidth":@3, @"tileSize":@256}) };
+
+    IA::TiledContext context { height, width, param };
+
+    XCTAssert(context.tiled());
+
+    auto segments = context.find_segments(&buffer);
+
+    XCTAssertEqual(segments.size(), 1);
+    if (segments.size()) {
+        XCTAssertLessThanOrEqual(simd::reduce_min(segments.front().even), 22);
+        XCTAssertGreaterThanOrEqual(simd::reduce_max(segments.front().even), 677);
+    }
+
+    auto streamed = context.read_segments([&] (vImagePixelCount y, vImagePixelCount x, vImagePixelCount count, uint8_t *pixels) {
+        std::copy_n(data.data() + y * width + x, count, pixels);
+    });
+
+    XCTAssertEqual(streamed.size(), 1);
+}
+
+- (void)testMemoryBudget {
+    NSDictionary<NSString *, id> *parameters = @{@"sensitivity":@12, @"maxGap":@2, @"minSegmentLength":@20, @"channelWidth":@3};
+
+    CFErrorRef cf_error = nullptr;
+    const SInt64 unlimited = IAEstimateMemoryUsage(4000, 4000, (__bridge CFDictionaryRef)(parameters), &cf_error);
+
+    // The border mask is a fixed cost; the budget can only squeeze
+    // the rest.
+
+    const SInt64 mask = IA::border_mask_footprint(4000, 4000);
+
+    XCTAssertGreaterThan(unlimited, mask + 4000 * 4000 * 2);
+
+    NSMutableDictionary<NSString *, id> *budgeted = [parameters mutableCopy];
+    budgeted[@"memoryBudget"] = @(mask + (unlimited - mask) / 2);
+
+    const SInt64 limited = IAEstimateMemoryUsage(4000, 4000, (__bridge CFDictionaryRef)(budgeted), &cf_error);
+
+    XCTAssertGreaterThan(limited, mask);
+    XCTAssertLessThanOrEqual(limited, mask + (unlimited - mask) / 2);
+
+    // A budget that forces tiling must not change what is found.
+
+    constexpr vImagePixelCount width = 700, height = 300;
+
+    std::vector<uint8_t> data(width * height, 0);
+
+    for (vImagePixelCount x = 20; x < 680; ++x) {
+        data[150 * width + x] = 0xff;
+    }
+
+    vImage_Buffer buffer = {
+        data.data(), height, width, width
+    };
+
+    const SInt64 small_mask = IA::border_mask_footprint(height, width);
+
+    budgeted[@"memoryBudget"] = @(small_mask + (IAEstimateMemoryUsage(width, height, (__bridge CFDictionaryRef)(parameters), &cf_error) - small_mask) / 4);
+
+    IA::UserParameters param { (__bridge CFDictionaryRef)(budgeted) };
+
+    const auto plan = IA::plan_memory(height, width, param);
+    XCTAssertLessThan(plan.tile_width, width);
+
+    IA::TiledContext context { height, width, param };
+    auto segments = context.find_segments(&buffer);
+
+    XCTAssertEqual(segments.size(), 1);
+
+    // A reusable context is held to the budget too.
+
+    IAAnalysisContextRef reusable = IAAnalysisContextCreate(width, height, (__bridge CFDictionaryRef)(budgeted), &cf_error);
+    XCTAssert(reusable != nullptr, @"%@", cf_error);
+
+    XCTAssertEqual(IAAnalysisContextFindSegments(reusable, &buffer, &cf_error), 1);
+
+    IAAnalysisContextRelease(reusable);
+}
+
+- (void)testStatistics {
+    static_assert(std::is_empty<IA::NullStats>::value, "disabled statistics must not take space");
+
+    auto page = frame_page();
+    vImage_Buffer buffer = page.buffer();
+
+    NSDictionary<NSString *, id> *parameters = @{@"sensitivity":@12, @"maxGap":@4, @"minSegmentLength":@15, @"channelWidth":@3};
+
+    CFDictionaryRef cf_statistics = nullptr;
+    CFErrorRef cf_error = nullptr;
+
+    NSArray<NSArray<NSNumber *> *> *regions = CFBridgingRelease(IACreateRegionArrayWithStatistics(&buffer, (__bridge CFDictionaryRef)(parameters), &cf_statistics, &cf_error));
+    NSDictionary<NSString *, id> *statistics = CFBridgingRelease(cf_statistics);
+
+    XCTAssertNotNil(regions, @"error - %@", cf_error);
+    XCTAssertEqual(regions.count, 1);
+
+    XCTAssertEqual([statistics[@"edgePixels"] integerValue], 320);
+    XCTAssertGreaterThan([statistics[@"votes"] integerValue], 0);
+    XCTAssertLessThanOrEqual([statistics[@"votes"] integerValue], 320);
+    XCTAssertGreaterThanOrEqual([statistics[@"rawSegments"] integerValue], [statistics[@"segments"] integerValue]);
+    XCTAssertGreaterThanOrEqual([statistics[@"segments"] integerValue], 4);
+    XCTAssertGreaterThanOrEqual([statistics[@"corners"] integerValue], 4);
+    XCTAssertGreaterThan([statistics[@"voteTime"] doubleValue], 0.0);
+    XCTAssertEqualObjects(statistics[@"partial"], @NO);
+}
+
+- (void)testTrace {
+    auto page = frame_page();
+    vImage_Buffer buffer = page.buffer();
+
+    NSDictionary<NSString *, id> *parameters = @{@"sensitivity":@12, @"maxGap":@4, @"minSegmentLength":@15, @"channelWidth":@3};
+
+    IATraceReset();
+    IATraceSetEnabled(true);
+
+    CFErrorRef cf_error = nullptr;
+    NSArray *regions = CFBridgingRelease(IACreateRegionArray(&buffer, (__bridge CFDictionaryRef)(parameters), &cf_error));
+
+    IATraceSetEnabled(false);
+
+    XCTAssertNotNil(regions, @"error - %@", cf_error);
+
+    NSData *data_json = CFBridgingRelease(IATraceCopyJSONData());
+
+    NSError *error = nil;
+    NSDictionary *trace = [NSJSONSerialization JSONObjectWithData:data_json options:0 error:&error];
+
+    XCTAssertNotNil(trace, @"error - %@", error);
+
+    NSSet<NSString *> *names = [NSSet setWithArray:[trace[@"traceEvents"] valueForKey:@"name"]];
+
+    for (NSString *name in @[@"Scoreboard", @"reset", @"vote", @"postprocess", @"find_corners", @"sort_regions"]) {
+        XCTAssert([names containsObject:name], @"missing span %@", name);
+    }
+
+    IATraceReset();
+
+    NSData *empty_json = CFBridgingRelease(IATraceCopyJSONData());
+    NSDictionary *empty = [NSJSONSerialization JSONObjectWithData:empty_json options:0 error:nil];
+
+    XCTAssertEqual([empty[@"traceEvents"] count], 0);
+}
+
+- (void)testAngleCount {
+    XCTAssertEqual(IA::angle_count(100, 0), 1024);
+    XCTAssertEqual(IA::angle_count(3000, 0), 2048);
+    XCTAssertEqual(IA::angle_count(3000, 300), 512);
+    XCTAssertEqual(IA::angle_count(100, 10000), 4096);
+    XCTAssertEqual(IA::angle_count(100, 1), 256);
+
+    auto page = frame_page();
+    vImage_Buffer buffer = page.buffer();
+
+    for (NSNumber *angles in @[@256, @512, @1024, @2048, @4096]) {
+        NSDictionary<NSString *, id> *parameters = @{@"sensitivity":@12, @"maxGap":@4, @"minSegmentLength":@15, @"channelWidth":@3, @"angleCount":angles};
+
+        IA::UserParameters param { (__bridge CFDictionaryRef)(parameters) };
+        IA::Scoreboard scoreboard { 128, 128, param };
+
+        XCTAssertEqual(scoreboard.angles(), angles.unsignedLongValue);
+
+        CFErrorRef cf_error = nullptr;
+        NSArray *segments = CFBridgingRelease(IACreateSegmentArray(&buffer, (__bridge CFDictionaryRef)(parameters), &cf_error));
+
+        XCTAssertNotNil(segments, @"error - %@", cf_error);
+        XCTAssertGreaterThanOrEqual(segments.count, 4, @"with %@ angles", angles);
+    }
+}
+
+- (void)testAngularWindow {
+    // The diagonal is a line that the windows exclude.
+
+    auto page = frame_page(true);
+    vImage_Buffer buffer = page.buffer();
+
+    IA::UserParameters param { (__bridge CFDictionaryRef)(@{@"sensitivity":@12, @"maxGap":@4, @"minSegmentLength":@15, @"channelWidth":@3, @"angularWindow":@3}) };
+
+    IA::Context context { 128, 128, param };
+
+    auto segments = context.find_segments(&buffer);
+
+    XCTAssertGreaterThanOrEqual(segments.size(), 4);
+
+    for (const auto &segment : segments) {
+        const simd::double2 delta = segment.hi - segment.lo;
+        const double degrees = std::atan2(std::fabs(delta.y), std::fabs(delta.x)) * 180.0 / M_PI;
+
+        XCTAssert(degrees <= 5 || degrees >= 85, @"segment at %g degrees", degrees);
+    }
+}
+
+- (void)testOrientationWindow {
+    auto page = frame_page(true);
+    vImage_Buffer buffer = page.buffer();
+
+    NSDictionary<NSString *, id> *parameters = @{@"sensitivity":@12, @"maxGap":@4, @"minSegmentLength":@15, @"channelWidth":@3};
+
+    NSMutableDictionary<NSString *, id> *guided = [parameters mutableCopy];
+    guided[@"orientationWindow"] = @5;
+
+    IA::BasicContext<IA::CollectStats> full { 128, 128, IA::UserParameters { (__bridge CFDictionaryRef)(parameters) } };
+    IA::BasicContext<IA::CollectStats> oriented { 128, 128, IA::UserParameters { (__bridge CFDictionaryRef)(guided) } };
+
+    const auto unguided_segments = full.find_segments(&buffer);
+    const auto guided_segments = oriented.find_segments(&buffer);
+
+    // Each guided vote fills only the few columns near the edge
+    // direction, rather than every column.
+
+    const auto unguided_stats = full.statistics();
+    const auto guided_stats = oriented.statistics();
+
+    XCTAssertGreaterThan(guided_stats.votes, 0);
+    XCTAssertLessThan(guided_stats.increments / guided_stats.votes, unguided_stats.increments / unguided_stats.votes / 4);
+
+    // Both find the frame and its diagonal.
+
+    const simd::double4 lines[] = {
+        {  20,  20, 100,  20 },
+        {  20, 100, 100, 100 },
+        {  20,  20,  20, 100 },
+        { 100,  20, 100, 100 },
+        {  20,  20, 100, 100 },
+    };
+
+    auto finds = [] (const std::vector<IA::segment_t> &segments, simd::double4 line) {
+        return std::any_of(segments.begin(), segments.end(), [line] (const IA::segment_t &segment) {
+            const simd::double4 reversed = line.zwxy;
+            return simd::reduce_max(simd::fabs(segment - line)) <= 4 || simd::reduce_max(simd::fabs(segment - reversed)) <= 4;
+        });
+    };
+
+    for (const auto &line : lines) {
+        XCTAssert(finds(unguided_segments, line), @"unguided run missed (%g, %g)-(%g, %g)", line.x, line.y, line.z, line.w);
+        XCTAssert(finds(guided_segments, line), @"guided run missed (%g, %g)-(%g, %g)", line.x, line.y, line.z, line.w);
+    }
+}
+
+- (void)testMappedImage {
+    auto page = two_line_page();
+    vImage_Buffer buffer = page.buffer();
+
+    const vImagePixelCount width = page.width, height = page.height;
+    const std::vector<uint8_t> &pixels = page.pixels;
+
+    NSDictionary<NSString *, id> *parameters = @{@"sensitivity":@12, @"maxGap":@4, @"minSegmentLength":@15, @"channelWidth":@3};
+
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSUUID UUID].UUIDString];
+
+    // A PGM file, with a comment in the header.
+
+    NSMutableData *pgm = [[@"P5\n# edge map\n128 96\n255\n" dataUsingEncoding:NSASCIIStringEncoding] mutableCopy];
+    [pgm appendBytes:pixels.data() length:pixels.size()];
+    XCTAssert([pgm writeToFile:path atomically:NO]);
+
+    CFErrorRef cf_error = nullptr;
+    IAMappedImageRef image = IAMappedImageCreateWithPGMFile(path.fileSystemRepresentation, &cf_error);
+
+    XCTAssert(image != nullptr, @"error - %@", cf_error);
+
+    if (image) {
+        const vImage_Buffer *mapped = IAMappedImageGetBuffer(image);
+
+        XCTAssertEqual(mapped->width, width);
+        XCTAssertEqual(mapped->height, height);
+        XCTAssertEqual(memcmp(mapped->data, pixels.data(), pixels.size()), 0);
+
+        NSArray *expected = CFBridgingRelease(IACreateSegmentArray(&buffer, (__bridge CFDictionaryRef)(parameters), &cf_error));
+        NSArray *segments = CFBridgingRelease(IACreateSegmentArray(mapped, (__bridge CFDictionaryRef)(parameters), &cf_error));
+
+        XCTAssertEqual(segments.count, expected.count);
+        XCTAssertEqual(segments.count, 2);
+
+        IAMappedImageRelease(image);
+    }
+
+    // A raw file with a 16-byte header and padded rows.
+
+    const size_t rowBytes = width + 16, offset = 16;
+
+    NSMutableData *raw = [NSMutableData dataWithLength:offset + rowBytes * height];
+    for (vImagePixelCount y = 0; y < height; ++y) {
+        memcpy(static_cast<uint8_t *>(raw.mutableBytes) + offset + rowBytes * y, pixels.data() + width * y, width);
+    }
+    XCTAssert([raw writeToFile:path atomically:NO]);
+
+    image = IAMappedImageCreateWithRawFile(path.fileSystemRepresentation, width, height, rowBytes, offset, &cf_error);
+
+    XCTAssert(image != nullptr, @"error - %@", cf_error);
+
+    if (image) {
+        NSArray *segments = CFBridgingRelease(IACreateSegmentArray(IAMappedImageGetBuffer(image), (__bridge CFDictionaryRef)(parameters), &cf_error));
+        XCTAssertEqual(segments.count, 2);
+
+        IAMappedImageRelease(image);
+    }
+
+    // Too short for the geometry.
+
+    image = IAMappedImageCreateWithRawFile(path.fileSystemRepresentation, width, height + 1, rowBytes, offset, &cf_error);
+
+    XCTAssert(image == nullptr);
+    if (!image) {
+        XCTAssertEqual(CFErrorGetCode(cf_error), kvImageBufferSizeMismatch);
+        CFRelease(cf_error);
+    }
+
+    [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+}
+
+- (void)testResultCache {
+    auto page = two_line_page();
+    vImage_Buffer buffer = page.buffer();
+
+    NSDictionary<NSString *, id> *parameters = @{@"sensitivity":@12, @"maxGap":@4, @"minSegmentLength":@15, @"channelWidth":@3, @"seed":@42};
+
+    NSString *directory = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSUUID UUID].UUIDString];
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+
+    CFErrorRef cf_error = nullptr;
+    IAResultCacheRef cache = IAResultCacheCreate(directory.fileSystemRepresentation, 0, &cf_error);
+
+    XCTAssert(cache != nullptr, @"error - %@", cf_error);
+    if (!cache) return;
+
+    NSArray *expected = CFBridgingRelease(IACreateSegmentArray(&buffer, (__bridge CFDictionaryRef)(parameters), &cf_error));
+    NSArray *computed = CFBridgingRelease(IAResultCacheCreateSegmentArray(cache, &buffer, (__bridge CFDictionaryRef)(parameters), &cf_error));
+
+    XCTAssertEqualObjects(computed, expected);
+    XCTAssertEqual([fileManager contentsOfDirectoryAtPath:directory error:NULL].count, 1);
+
+    // A second lookup is served from the file, even through a new cache.
+
+    IAResultCacheRelease(cache);
+    cache = IAResultCacheCreate(directory.fileSystemRepresentation, 0, &cf_error);
+
+    NSArray *cached = CFBridgingRelease(IAResultCacheCreateSegmentArray(cache, &buffer, (__bridge CFDictionaryRef)(parameters), &cf_error));
+
+    XCTAssertEqualObjects(cached, expected);
+
+    // A file whose count disagrees with its size is a miss, and the
+    // result is computed again.
+
+    NSString *file = [directory stringByAppendingPathComponent:[[fileManager contentsOfDirectoryAtPath:directory error:NULL] filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"self ENDSWITH '.iar'"]].firstObject];
+    NSMutableData *header = [[[NSData dataWithContentsOfFile:file] subdataWithRange:NSMakeRange(0, 16)] mutableCopy];
+
+    const uint32_t count = UINT32_MAX;
+    [header replaceBytesInRange:NSMakeRange(12, sizeof(count)) withBytes:&count];
+    [header writeToFile:file atomically:YES];
+
+    NSArray *recomputed = CFBridgingRelease(IAResultCacheCreateSegmentArray(cache, &buffer, (__bridge CFDictionaryRef)(parameters), &cf_error));
+
+    XCTAssertEqualObjects(recomputed, expected);
+    XCTAssertEqual([NSData dataWithContentsOfFile:file].length, 16 + expected.count * sizeof(simd::double4));
+
+    // Changing a pixel or a parameter misses.
+
+    page.at(64, 50) = 0xff;
+    (void)CFBridgingRelease(IAResultCacheCreateSegmentArray(cache, &buffer, (__bridge CFDictionaryRef)(parameters), &cf_error));
+
+    NSMutableDictionary<NSString *, id> *changed = [parameters mutableCopy];
+    changed[@"seed"] = @43;
+    (void)CFBridgingRelease(IAResultCacheCreateSegmentArray(cache, &buffer, (__bridge CFDictionaryRef)(changed), &cf_error));
+
+    NSArray *files = [fileManager contentsOfDirectoryAtPath:directory error:NULL];
+    XCTAssertEqual([files filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"self ENDSWITH '.iar'"]].count, 3);
+
+    IAResultCacheRelease(cache);
+
+    [fileManager removeItemAtPath:directory error:NULL];
+}
+
+- (void)testParameterSets {
+    auto page = two_line_page();
+
+    for (vImagePixelCount y = 30; y < 70; ++y) {
+        page.at(64, y) = 0xff;
+    }
+
+    vImage_Buffer buffer = page.buffer();
+
+    NSArray<NSDictionary<NSString *, id> *> *parameterSets = @[
+        @{@"sensitivity":@12, @"maxGap":@4, @"minSegmentLength":@15, @"channelWidth":@3, @"seed":@7},
+        @{@"sensitivity":@12, @"maxGap":@4, @"minSegmentLength":@50, @"channelWidth":@3, @"seed":@7},
+        @{@"sensitivity":@8,  @"maxGap":@2, @"minSegmentLength":@15, @"channelWidth":@5, @"seed":@7},
+        @{@"sensitivity":@12, @"maxGap":@4, @"minSegmentLength":@15, @"channelWidth":@3, @"seed":@7, @"tileSize":@256},
+    ];
+
+    CFErrorRef cf_error = nullptr;
+    NSArray<NSArray *> *results = CFBridgingRelease(IACreateSegmentArraysForParameterSets(&buffer, (__bridge CFArrayRef)(parameterSets), &cf_error));
+
+    XCTAssertNotNil(results, @"error - %@", cf_error);
+    XCTAssertEqual(results.count, parameterSets.count);
+
+    // Each variant matches a separate analysis with its parameters.
+
+    [parameterSets enumerateObjectsUsingBlock:^(NSDictionary<NSString *, id> *parameters, NSUInteger i, BOOL *stop) {
+        NSArray *expected = CFBridgingRelease(IACreateSegmentArray(&buffer, (__bridge CFDictionaryRef)(parameters), NULL));
+        XCTAssertEqualObjects(results[i], expected, @"variant %lu", (unsigned long)i);
+    }];
+
+    XCTAssertEqual(results[0].count, 3);
+    XCTAssertEqual(results[1].count, 2);
+
+    // A bad parameter set fails the whole sweep.
+
+    NSArray *bad = @[parameterSets[0], @{@"sensitivity":@12}];
+    XCTAssertNil(CFBridgingRelease(IACreateSegmentArraysForParameterSets(&buffer, (__bridge CFArrayRef)(bad), &cf_error)));
+    if (cf_error) CFRelease(cf_error);
+}
+
+- (void)testEdgeScan {
+    // Large enough to be scanned in parallel bands, with a width that
+    // is not a multiple of the word size.
+
+    constexpr vImagePixelCount width = 2403, height = 2001;
+
+    std::vector<uint8_t> pixels(width * height);
+    std::default_random_engine rng { 42 };
+    std::uniform_int_distribution<int> value { 0, 255 };
+
+    std::size_t expected = 0;
+
+    for (auto &pixel : pixels) {
+        pixel = (value(rng) < 8) ? value(rng) | 0x80 : value(rng) & 0x7f;
+        if (pixel >= 128) ++expected;
+    }
+
+    vImage_Buffer buffer = {
+        pixels.data(), height, width, width
+    };
+
+    NSDictionary<NSString *, id> *parameters = @{@"sensitivity":@12, @"maxGap":@4, @"minSegmentLength":@15, @"channelWidth":@3, @"maxVotes":@1};
+
+    CFErrorRef cf_error = nullptr;
+    CFDictionaryRef cf_statistics = nullptr;
+
+    NSArray *segments = CFBridgingRelease(IACreateSegmentArrayWithStatistics(&buffer, (__bridge CFDictionaryRef)(parameters), &cf_statistics, &cf_error));
+    NSDictionary *statistics = CFBridgingRelease(cf_statistics);
+
+    XCTAssertNotNil(segments, @"error - %@", cf_error);
+    XCTAssertEqual([statistics[@"edgePixels"] unsignedLongValue], expected);
+}
+
+- (void)testVoteBatch {
+    auto page = frame_page(true);
+    vImage_Buffer buffer = page.buffer();
+
+    NSDictionary<NSString *, id> *parameters = @{@"sensitivity":@12, @"maxGap":@4, @"minSegmentLength":@15, @"channelWidth":@3};
+
+    NSMutableDictionary<NSString *, id> *batched = [parameters mutableCopy];
+    batched[@"voteBatchSize"] = @16;
+
+    NSMutableDictionary<NSString *, id> *guided = [batched mutableCopy];
+    guided[@"orientationWindow"] = @5;
+
+    IA::BasicContext<IA::CollectStats> single { 128, 128, IA::UserParameters { (__bridge CFDictionaryRef)(parameters) } };
+
+    XCTAssertGreaterThanOrEqual(single.find_segments(&buffer).size(), 5);
+
+    for (NSDictionary *variant in @[batched, guided]) {
+        IA::BasicContext<IA::CollectStats> context { 128, 128, IA::UserParameters { (__bridge CFDictionaryRef)(variant) } };
+
+        // Batching changes only how the votes are computed: the same
+        // edge pixels are queued, votes are cast, and the lines found.
+
+        XCTAssertGreaterThanOrEqual(context.find_segments(&buffer).size(), 5);
+        XCTAssertEqual(context.statistics().edge_pixels, single.statistics().edge_pixels);
+        XCTAssertGreaterThan(context.statistics().votes, 0);
+        XCTAssertFalse(context.partial());
+    }
+
+    // The curves of a batch count against the memory estimate, and
+    // oversized batches are clamped.
+
+    const IA::UserParameters plain { (__bridge CFDictionaryRef)(parameters) };
+    const IA::UserParameters batch { (__bridge CFDictionaryRef)(batched) };
+
+    NSMutableDictionary<NSString *, id> *huge = [parameters mutableCopy];
+    huge[@"voteBatchSize"] = @(1 << 20);
+
+    const IA::UserParameters clamped { (__bridge CFDictionaryRef)(huge) };
+
+    const std::size_t angles = IA::Scoreboard { 128, 128, plain }.angles();
+    const std::size_t base = IA::Context::footprint(128, 128, plain);
+
+    XCTAssertEqual(IA::Context::footprint(128, 128, batch) - base, 16 * angles * sizeof(uint16_t));
+    XCTAssertEqual(IA::Context::footprint(128, 128, clamped) - base, IA::Scoreboard::max_vote_batch() * angles * sizeof(uint16_t));
+}
+
+- (void)testStandardHough {
+    auto page = frame_page(true);
+    vImage_Buffer buffer = page.buffer();
+
+    NSDictionary<NSString *, id> *parameters = @{@"sensitivity":@12, @"maxGap":@4, @"minSegmentLength":@15, @"channelWidth":@3, @"standardHough":@1};
+
+    IA::BasicContext<IA::CollectStats> context { 128, 128, IA::UserParameters { (__bridge CFDictionaryRef)(parameters) } };
+
+    const auto segments = context.find_segments(&buffer);
+
+    // Every pixel votes once, and the five lines are found.
+
+    XCTAssertGreaterThanOrEqual(segments.size(), 5);
+    XCTAssertEqual(context.statistics().votes, context.statistics().edge_pixels);
+
+    for (const auto &segment : segments) {
+        XCTAssertGreaterThanOrEqual(simd::distance(segment.lo, segment.hi), 15.0);
+    }
+
+    // Reusing the context withdraws the votes left by the first image.
+
+    XCTAssertEqual(context.find_segments(&buffer).size(), segments.size());
+}
+
+- (void)testStandardHoughSaturation {
+    constexpr vImagePixelCount width = 16384, height = 8;
+
+    // At 256 angles the rho bins are 64 rows high, so the four rows of
+    // this band all vote for one bin, 65536 times in all.
+
+    std::vector<uint8_t> data(width * height, 0);
+    std::fill_n(data.begin(), 4 * width, 0xff);
+
+    vImage_Buffer buffer = {
+        data.data(), height, width, width
+    };
+
+    NSDictionary<NSString *, id> *parameters = @{@"sensitivity":@12, @"maxGap":@4, @"minSegmentLength":@15, @"channelWidth":@3, @"standardHough":@1, @"angleCount":@256};
+
+    IA::BasicContext<IA::CollectStats> context { height, width, IA::UserParameters { (__bridge CFDictionaryRef)(parameters) } };
+
+    const auto segments = context.find_segments(&buffer);
+
+    // Had the count wrapped to zero, only the short crossings of the
+    // band by neighboring angles would be found.
+
+    auto spans = [] (const std::vector<IA::segment_t> &segments) {
+        return std::any_of(segments.begin(), segments.end(), [] (const IA::segment_t &segment) {
+            return simd::distance(segment.lo, segment.hi) >= width - 16;
+        });
+    };
+
+    XCTAssert(spans(segments));
+
+    // Withdrawing the votes must not wrap the saturated cell, which
+    // would leave a false peak for the next page.
+
+    XCTAssert(spans(context.find_segments(&buffer)));
+
+    std::fill(data.begin(), data.end(), 0);
+
+    XCTAssertEqual(context.find_segments(&buffer).size(), 0);
+}
+
+- (void)testWarmStart {
+    // The second page has the same frame, shifted by two pixels.
+
+    auto page1 = frame_page(), page2 = frame_page(false, 2);
+
+    vImage_Buffer buffer1 = page1.buffer();
+    vImage_Buffer buffer2 = page2.buffer();
+
+    NSDictionary<NSString *, id> *parameters = @{@"sensitivity":@12, @"maxGap":@4, @"minSegmentLength":@15, @"channelWidth":@3, @"hintRadius":@4};
+
+    IA::BasicContext<IA::CollectStats> context { 128, 128, IA::UserParameters { (__bridge CFDictionaryRef)(parameters) } };
+
+    const auto hints = context.find_segments(&buffer1);
+    XCTAssertEqual(hints.size(), 4);
+
+    const auto cold = context.statistics().votes;
+
+    // The hints find every side, so the only pixels left to vote are
+    // those the channels missed.
+
+    context.set_hints(hints);
+
+    const auto segments = context.find_segments(&buffer2);
+    XCTAssertEqual(segments.size(), 4);
+    XCTAssertLessThan(context.statistics().votes, cold / 4);
+
+    for (const auto &segment : segments) {
+        XCTAssertGreaterThanOrEqual(simd::reduce_min(segment), 21.0);
+        XCTAssertLessThanOrEqual(simd::reduce_max(segment), 103.0);
+    }
+
+    // The C interface takes the segments of the previous page as it
+    // returned them.
+
+    CFErrorRef cf_error = nullptr;
+
+    NSArray *previous = CFBridgingRelease(IACreateSegmentArray(&buffer1, (__bridge CFDictionaryRef)(parameters), &cf_error));
+    XCTAssertNotNil(previous, @"%@", cf_error);
+
+    NSArray *result = CFBridgingRelease(IACreateSegmentArrayWithHints(&buffer2, (__bridge CFDictionaryRef)(parameters), (__bridge CFArrayRef)(previous), &cf_error));
+    XCTAssertNotNil(result, @"%@", cf_error);
+    XCTAssertEqual(result.count, 4);
+}
+
+- (void)testSinglePrecisionGeometry {
+    constexpr vImagePixelCount width = 320, height = 240;
+
+    std::vector<uint8_t> pixels(width * height, 0);
+
+    // Six panels in two rows.
+
+    for (vImagePixelCount row = 0; row < 2; ++row) {
+        for (vImagePixelCount column = 0; column < 3; ++column) {
+            const vImagePixelCount x0 = 10 + column * 100, y0 = 10 + row * 110;
+            const vImagePixelCount x1 = x0 + 90, y1 = y0 + 100;
+
+            for (vImagePixelCount x = x0; x <= x1; ++x) {
+                pixels[y0 * width + x] = pixels[y1 * width + x] = 0xff;
+            }
+
+            for (vImagePixelCount y = y0; y <= y1; ++y) {
+                pixels[y * width + x0] = pixels[y * width + x1] = 0xff;
+            }
+        }
+    }
+
+    vImage_Buffer buffer = {
+        pixels.data(), height, width, width
+    };
+
+    // With the same seed the votes are identical, so only the geometry
+    // differs.
+
+    NSDictionary<NSString *, id> *single = @{@"sensitivity":@12, @"maxGap":@4, @"minSegmentLength":@15, @"channelWidth":@3, @"seed":@7};
+    NSDictionary<NSString *, id> *doubled = @{@"sensitivity":@12, @"maxGap":@4, @"minSegmentLength":@15, @"channelWidth":@3, @"seed":@7, @"doubleGeometry":@1};
+
+    IA::Context single_context { height, width, IA::UserParameters { (__bridge CFDictionaryRef)(single) } };
+    IA::Context double_context { height, width, IA::UserParameters { (__bridge CFDictionaryRef)(doubled) } };
+
+    const auto single_regions = single_context.find_regions(&buffer);
+    const auto double_regions = double_context.find_regions(&buffer);
+
+    XCTAssertEqual(single_regions.size(), 6);
+    XCTAssertEqual(single_regions.size(), double_regions.size());
+
+    for (std::size_t i = 0; i < std::min(single_regions.size(), double_regions.size()); ++i) {
+        XCTAssertLessThan(simd::reduce_max(simd::fabs(single_regions[i] - double_regions[i])), 1.0);
+    }
+
+    // Far from the origin, where a float resolves 1/128 pixel, the
+    // geometry still agrees.
+
+    std::vector<IA::segment_t> segments = {
+        IA::segment_t{0, 0, 6, 0},
+        IA::segment_t{4, 0, 10, 0},
+        IA::segment_t{10, 0, 10, 5},
+        IA::segment_t{0, 0, 0, 10},
+        IA::segment_t{0, 10, 5, 10},
+        IA::segment_t{5, 5, 5, 20},
+        IA::segment_t{5, 5, 20, 5},
+        IA::segment_t{5, 20, 21, 20},
+        IA::segment_t{20, 5, 20, 21}
+    };
+
+    for (auto &segment : segments) segment += 60000.0;
+
+    auto single_segments = segments;
+    auto double_segments = segments;
+
+    IA::postprocess_in<float>(single_segments);
+    IA::postprocess_in<double>(double_segments);
+
+    XCTAssertEqual(single_segments.size(), 8);
+    XCTAssertEqual(single_segments.size(), double_segments.size());
+
+    std::vector<IA::Region> single_found, double_found;
+
+    XCTAssertEqual(IA::find_sorted_regions<float>(double_segments, single_found, 1.0), IA::find_sorted_regions<double>(double_segments, double_found, 1.0));
+    XCTAssertEqual(single_found.size(), 2);
+    XCTAssertEqual(single_found.size(), double_found.size());
+
+    for (std::size_t i = 0; i < std::min(single_found.size(), double_found.size()); ++i) {
+        XCTAssertLessThan(simd::reduce_max(simd::fabs(single_found[i] - double_found[i])), 1.0 / 64);
+    }
+}
+
+- (void)testSegmentsAndRegions {
+    auto page = frame_page();
+    vImage_Buffer buffer = page.buffer();
+
+    NSDictionary<NSString *, id> *parameters = @{@"sensitivity":@12, @"maxGap":@4, @"minSegmentLength":@15, @"channelWidth":@3, @"seed":@7};
+
+    CFErrorRef cf_error = nullptr;
+    CFArrayRef cf_segments = nullptr, cf_regions = nullptr;
+
+    XCTAssert(IACreateSegmentAndRegionArrays(&buffer, (__bridge CFDictionaryRef)(parameters), &cf_segments, &cf_regions, &cf_error), @"%@", cf_error);
+
+    NSArray *segments = CFBridgingRelease(cf_segments);
+    NSArray *regions = CFBridgingRelease(cf_regions);
+
+    // One analysis gives what two seeded analyses would.
+
+    NSArray *expected_segments = CFBridgingRelease(IACreateSegmentArray(&buffer, (__bridge CFDictionaryRef)(parameters), &cf_error));
+    NSArray *expected_regions = CFBridgingRelease(IACreateRegionArray(&buffer, (__bridge CFDictionaryRef)(parameters), &cf_error));
+
+    XCTAssertEqualObjects(segments, expected_segments);
+    XCTAssertEqualObjects(regions, expected_regions);
+    XCTAssertEqual(regions.count, 1);
+}
+
+- (void)testCandidateMarks {
+    uint8_t lines[16][16] = { };
+
+    for (int i = 0; i < 16; ++i) {
+        lines[3][i] = 0xff;
+    }
+
+    vImage_Buffer buffer = {
+        lines, 16, 16, 16
+    };
+
+    IA::UserParameters param { (__bridge CFDictionaryRef)(@{@"sensitivity":@12, @"maxGap":@3, @"minSegmentLength":@10, @"channelWidth":@3}) };
+
+    IA::Scoreboard scoreboard { 16, 16, param };
+    scoreboard.reset(&buffer);
+
+    const vImagePixelCount theta = scoreboard.angles() / 4;
+
+    auto count = [&scoreboard, theta] () {
+        std::size_t n = 0;
+
+        for (auto &candidate : scoreboard.scan_channel(theta, 3)) {
+            n += std::distance(candidate.begin(), candidate.end());
+        }
+
+        return n;
+    };
+
+    // Candidates discarded by one scan hold nothing in the next, even
+    // after the epochs wrap around.
+
+    XCTAssertEqual(count(), 16);
+    XCTAssertEqual(count(), 16);
+
+    for (int i = 0; i < 0x10000; ++i) {
+        (void)scoreboard.scan_channel(theta, 3);
+    }
+
+    XCTAssertEqual(count(), 16);
+
+    // A committed candidate keeps its pixels.
+
+    for (auto &candidate : scoreboard.scan_channel(theta, 3)) {
+        candidate.commit();
+    }
+
+    XCTAssertEqual(count(), 0);
+}
+
+- (void)testAsyncAnalysis {
+    auto page = two_line_page();
+    vImage_Buffer buffer = page.buffer();
+
+    NSDictionary<NSString *, id> *parameters = @{@"sensitivity":@12, @"maxGap":@4, @"minSegmentLength":@15, @"channelWidth":@3};
+
+    auto progress = [] (double fraction, void *info) {
+        static_cast<AsyncResult *>(info)->progress = fraction;
+    };
+
+    auto completion = [] (CFArrayRef result, CFErrorRef error, void *info) {
+        auto r = static_cast<AsyncResult *>(info);
+        r->result = (__bridge NSArray *)(result);
+        r->error = (__bridge NSError *)(error);
+        dispatch_semaphore_signal(r->done);
+    };
+
+    dispatch_queue_t queue = dispatch_queue_create("IABufferAnalysisTests.async", DISPATCH_QUEUE_SERIAL);
+
+    // A completed analysis.
+
+    AsyncResult finished;
+    CFErrorRef cf_error = nullptr;
+
+    IAAnalysisTaskRef task = IAAnalysisTaskCreateForSegments(&buffer, (__bridge CFDictionaryRef)(parameters), queue, progress, completion, &finished, &cf_error);
+    XCTAssert(task != nullptr, @"error - %@", cf_error);
+
+    dispatch_semaphore_wait(finished.done, DISPATCH_TIME_FOREVER);
+    IAAnalysisTaskRelease(task);
+
+    XCTAssertNil(finished.error);
+    XCTAssertEqual(finished.result.count, 2);
+    XCTAssertEqual(finished.progress, 1.0);
+
+    // An analysis cancelled before it starts.
+
+    AsyncResult cancelled;
+
+    dispatch_suspend(queue);
+
+    task = IAAnalysisTaskCreateForRegions(&buffer, (__bridge CFDictionaryRef)(parameters), queue, nullptr, completion, &cancelled, &cf_error);
+    IAAnalysisTaskCancel(task);
+    IAAnalysisTaskRelease(task);
+
+    dispatch_resume(queue);
+    dispatch_semaphore_wait(cancelled.done, DISPATCH_TIME_FOREVER);
+
+    XCTAssertNil(cancelled.result);
+    XCTAssertEqualObjects(cancelled.error.domain, NSPOSIXErrorDomain);
+    XCTAssertEqual(cancelled.error.code, ECANCELED);
+
+    // Invalid parameters fail at once.
+
+    XCTAssert(IAAnalysisTaskCreateForSegments(&buffer, (__bridge CFDictionaryRef)(@{}), queue, nullptr, completion, &cancelled, &cf_error) == nullptr);
+    if (cf_error) CFRelease(cf_error);
+}
+
 - (void)testHoughRandom {
     uint8_t data[1024][1024] = { };
 
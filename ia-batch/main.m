@@ -0,0 +1,401 @@
+//
+//  main.m
+//  ia-batch
+//
+//  Created by Rob Menke on 10/18/26.
+//  Copyright © 2026 Rob Menke. All rights reserved.
+//
+
+@import Foundation;
+@import ImageAnalysisKit;
+
+#import "IAToolSupport.h"
+
+#include <ctype.h>
+#include <getopt.h>
+#include <stdatomic.h>
+#include <sysexits.h>
+
+// Runs the border mask, closing, and Hough stages over a batch of page
+// images on a fixed number of workers, writing one JSON object per page
+// to the output and a throughput summary to standard error.
+
+static const char *usage =
+    "usage: ia-batch [-j workers] [-p params.json] [-s name=value]... [-k kernel]\n"
+    "                [-m segments|regions|both] [-o output.jsonl] [-l list] [path ...]\n"
+    "\n"
+    "  -j workers   pages analyzed at once (default: active processors)\n"
+    "  -p file      JSON object of analysis parameters\n"
+    "  -s name=val  set one analysis parameter (may be repeated)\n"
+    "  -k kernel    size of the closing applied to the border mask, 0 for none (default: 3)\n"
+    "  -f fuzz      border mask fuzziness (default: 13.7)\n"
+    "  -m results   what to report for each page (default: both)\n"
+    "  -o file      write JSON Lines here instead of standard output\n"
+    "  -l list      read page paths, one per line, from this file (- for standard input)\n"
+    "\n"
+    "Each path may be an image file (PNG, JPEG, TIFF, binary PGM, ...) or a directory,\n"
+    "whose image files are analyzed in name order.\n";
+
+@interface IABatchOptions : NSObject
+
+@property (nonatomic) NSUInteger workers;
+@property (nonatomic) NSUInteger kernelSize;
+@property (nonatomic) float fuzziness;
+@property (nonatomic) IAToolResults results;
+@property (nonatomic, copy) NSDictionary<NSString *, id> *parameters;
+
+@end
+
+@implementation IABatchOptions
+@end
+
+#pragma mark - Loading
+
+/*!
+ * @abstract Load a binary (P5) PGM file, which ImageIO does not read.
+ * @discussion Sixteen-bit samples are reduced to eight bits.  The header
+ *   is checked as strictly as @c IAMappedImageCreateWithPGMFile checks
+ *   it, so a hostile one is rejected rather than overflowing.
+ */
+static IABuffer *IABatchLoadPGM(NSData *data, NSError **error) {
+    const uint8_t *bytes = data.bytes;
+    const NSUInteger length = data.length;
+
+    NSUInteger pos = 2;
+    NSUInteger fields[3];
+
+    for (int i = 0; i < 3; ++i) {
+        // Skip whitespace and comments.
+
+        while (pos < length && (isspace(bytes[pos]) || bytes[pos] == '#')) {
+            if (bytes[pos] == '#') {
+                while (pos < length && bytes[pos] != '\n') ++pos;
+            }
+            else {
+                ++pos;
+            }
+        }
+
+        if (pos >= length || !isdigit(bytes[pos])) {
+            if (error) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:EFTYPE userInfo:nil];
+            return nil;
+        }
+
+        NSUInteger value = 0;
+
+        while (pos < length && isdigit(bytes[pos]) && value <= UINT32_MAX) {
+            value = value * 10 + (bytes[pos++] - '0');
+        }
+
+        fields[i] = value;
+    }
+
+    // Exactly one whitespace character separates the header from the
+    // samples.
+
+    if (pos >= length || !isspace(bytes[pos++])) {
+        if (error) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:EFTYPE userInfo:nil];
+        return nil;
+    }
+
+    const NSUInteger width = fields[0], height = fields[1], maxval = fields[2];
+    const NSUInteger sampleSize = maxval < 256 ? 1 : 2;
+
+    NSUInteger count, bytesNeeded;
+
+    if (width == 0 || height == 0 || maxval == 0 || maxval > 65535 || __builtin_mul_overflow(width, height, &count) || __builtin_mul_overflow(count, sampleSize, &bytesNeeded) || bytesNeeded > length - pos) {
+        if (error) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:EFTYPE userInfo:nil];
+        return nil;
+    }
+
+    NSMutableData *pixels = [NSMutableData dataWithLength:count];
+
+    if (!pixels) {
+        if (error) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
+        return nil;
+    }
+
+    uint8_t *dst = pixels.mutableBytes;
+    const uint8_t *src = bytes + pos;
+
+    for (NSUInteger i = 0; i < count; ++i) {
+        const NSUInteger sample = sampleSize == 1 ? src[i] : ((NSUInteger)src[2 * i] << 8 | src[2 * i + 1]);
+        dst[i] = (uint8_t)((sample * 255 + maxval / 2) / maxval);
+    }
+
+    CGDataProviderRef provider = CGDataProviderCreateWithCFData((__bridge CFDataRef)pixels);
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateWithName(kCGColorSpaceGenericGray);
+
+    CGImageRef image = CGImageCreate(width, height, 8, 8, width, colorSpace, kCGBitmapByteOrderDefault | kCGImageAlphaNone, provider, NULL, false, kCGRenderingIntentDefault);
+
+    CGColorSpaceRelease(colorSpace);
+    CGDataProviderRelease(provider);
+
+    if (!image) {
+        if (error) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:EFTYPE userInfo:nil];
+        return nil;
+    }
+
+    IABuffer *buffer = [[IABuffer alloc] initWithImage:image error:error];
+
+    CGImageRelease(image);
+
+    return buffer;
+}
+
+static IABuffer *IABatchLoadImage(NSURL *url, NSError **error) {
+    NSData *data = [NSData dataWithContentsOfURL:url options:NSDataReadingMappedIfSafe error:error];
+    if (!data) return nil;
+
+    if (data.length >= 2 && memcmp(data.bytes, "P5", 2) == 0) {
+        return IABatchLoadPGM(data, error);
+    }
+
+    return [[IABuffer alloc] initWithContentsOfURL:url error:error];
+}
+
+#pragma mark - Analysis
+
+static BOOL IABatchAnalyzeImage(NSURL *url, IABatchOptions *options, NSMutableDictionary<NSString *, id> *record, NSError **error) {
+    IABuffer *image = IABatchLoadImage(url, error);
+    if (!image) return NO;
+
+    record[@"width"]  = @(image.width);
+    record[@"height"] = @(image.height);
+
+    NSArray *segments, *regions;
+
+    if (!IAToolAnalyzePage(image, options.fuzziness, options.kernelSize, options.parameters, options.results, &segments, &regions, NULL, error)) return NO;
+
+    if (segments) record[@"segments"] = segments;
+    if (regions)  record[@"regions"]  = regions;
+
+    return YES;
+}
+
+static NSMutableDictionary<NSString *, id> *IABatchAnalyzePage(NSURL *url, IABatchOptions *options) {
+    NSMutableDictionary<NSString *, id> *record = [NSMutableDictionary dictionary];
+    record[@"path"] = url.path;
+
+    NSError * __autoreleasing error = nil;
+
+    if (!IABatchAnalyzeImage(url, options, record, &error)) {
+        record[@"error"] = error.localizedDescription ?: @"unknown error";
+    }
+
+    return record;
+}
+
+#pragma mark - Inputs
+
+static BOOL IABatchIsImage(NSURL *url) {
+    static NSSet<NSString *> *extensions;
+    static dispatch_once_t once;
+
+    dispatch_once(&once, ^{
+        extensions = [NSSet setWithArray:@[@"png", @"jpg", @"jpeg", @"tif", @"tiff", @"gif", @"bmp", @"pgm"]];
+    });
+
+    return [extensions containsObject:url.pathExtension.lowercaseString];
+}
+
+static void IABatchAddPath(NSString *path, NSMutableArray<NSURL *> *urls) {
+    NSURL *url = [NSURL fileURLWithPath:path.stringByExpandingTildeInPath];
+
+    NSNumber *isDirectory = nil;
+    [url getResourceValue:&isDirectory forKey:NSURLIsDirectoryKey error:NULL];
+
+    if (!isDirectory.boolValue) {
+        [urls addObject:url];
+        return;
+    }
+
+    NSArray<NSURL *> *contents = [[NSFileManager defaultManager] contentsOfDirectoryAtURL:url includingPropertiesForKeys:nil options:NSDirectoryEnumerationSkipsHiddenFiles error:NULL];
+
+    contents = [contents sortedArrayUsingComparator:^NSComparisonResult(NSURL *a, NSURL *b) {
+        return [a.lastPathComponent localizedStandardCompare:b.lastPathComponent];
+    }];
+
+    for (NSURL *item in contents) {
+        if (IABatchIsImage(item)) [urls addObject:item];
+    }
+}
+
+static BOOL IABatchAddList(NSString *listPath, NSMutableArray<NSURL *> *urls, NSError **error) {
+    NSData *data;
+
+    if ([listPath isEqualToString:@"-"]) {
+        data = [[NSFileHandle fileHandleWithStandardInput] readDataToEndOfFile];
+    }
+    else {
+        data = [NSData dataWithContentsOfFile:listPath.stringByExpandingTildeInPath options:0 error:error];
+    }
+
+    if (!data) return NO;
+
+    NSString *list = [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
+
+    for (NSString *line in [list componentsSeparatedByCharactersInSet:[NSCharacterSet newlineCharacterSet]]) {
+        NSString *path = [line stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+        if (path.length) IABatchAddPath(path, urls);
+    }
+
+    return YES;
+}
+
+#pragma mark - Main
+
+int main(int argc, char * const argv[]) {
+    @autoreleasepool {
+        IABatchOptions *options = [[IABatchOptions alloc] init];
+
+        options.workers    = [NSProcessInfo processInfo].activeProcessorCount;
+        options.kernelSize = 3;
+        options.fuzziness  = 13.7f;
+        options.results    = IAToolResultsSegments | IAToolResultsRegions;
+
+        NSMutableDictionary<NSString *, id> *parameters = IAToolDefaultParameters();
+        NSMutableArray<NSURL *> *urls = [NSMutableArray array];
+        NSString *outputPath = nil;
+
+        int ch;
+
+        while ((ch = getopt(argc, argv, "j:p:s:k:f:m:o:l:h")) != -1) {
+            NSString *arg = optarg ? @(optarg) : nil;
+
+            switch (ch) {
+                case 'j':
+                    options.workers = MAX(arg.integerValue, 1);
+                    break;
+
+                case 'p':
+                case 's': {
+                    const int status = IAToolParseParameterOption("ia-batch", ch, optarg, parameters);
+                    if (status != EX_OK) return status;
+                    break;
+                }
+
+                case 'k':
+                    options.kernelSize = MAX(arg.integerValue, 0);
+                    break;
+
+                case 'f':
+                    options.fuzziness = arg.floatValue;
+                    break;
+
+                case 'm':
+                    if ([arg isEqualToString:@"segments"]) {
+                        options.results = IAToolResultsSegments;
+                    }
+                    else if ([arg isEqualToString:@"regions"]) {
+                        options.results = IAToolResultsRegions;
+                    }
+                    else if ([arg isEqualToString:@"both"]) {
+                        options.results = IAToolResultsSegments | IAToolResultsRegions;
+                    }
+                    else {
+                        fputs(usage, stderr);
+                        return EX_USAGE;
+                    }
+                    break;
+
+                case 'o':
+                    outputPath = arg;
+                    break;
+
+                case 'l': {
+                    NSError *error = nil;
+
+                    if (!IABatchAddList(arg, urls, &error)) {
+                        fprintf(stderr, "ia-batch: %s: %s\n", optarg, error.localizedDescription.UTF8String ?: "cannot read list");
+                        return EX_NOINPUT;
+                    }
+                    break;
+                }
+
+                default:
+                    fputs(usage, stderr);
+                    return ch == 'h' ? EX_OK : EX_USAGE;
+            }
+        }
+
+        for (int i = optind; i < argc; ++i) {
+            IABatchAddPath(@(argv[i]), urls);
+        }
+
+        if (urls.count == 0) {
+            fputs(usage, stderr);
+            return EX_USAGE;
+        }
+
+        options.parameters = parameters;
+
+        FILE *output = stdout;
+
+        if (outputPath) {
+            output = fopen(outputPath.fileSystemRepresentation, "w");
+
+            if (!output) {
+                fprintf(stderr, "ia-batch: %s: %s\n", outputPath.fileSystemRepresentation, strerror(errno));
+                return EX_CANTCREAT;
+            }
+        }
+
+        // Each worker takes the next page until none remain.  Records
+        // are written in completion order on a serial queue, which
+        // also collects the latencies.
+
+        dispatch_queue_t writer = dispatch_queue_create("ia-batch.writer", DISPATCH_QUEUE_SERIAL);
+        dispatch_group_t group = dispatch_group_create();
+
+        NSMutableArray<NSNumber *> *latencies = [NSMutableArray arrayWithCapacity:urls.count];
+        __block NSUInteger failures = 0;
+
+        static atomic_size_t next;
+        atomic_store(&next, 0);
+
+        const NSTimeInterval start = [NSProcessInfo processInfo].systemUptime;
+
+        for (NSUInteger worker = 0; worker < MIN(options.workers, urls.count); ++worker) {
+            dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+                for (size_t index; (index = atomic_fetch_add(&next, 1)) < urls.count; ) {
+                    @autoreleasepool {
+                        const NSTimeInterval began = [NSProcessInfo processInfo].systemUptime;
+
+                        NSMutableDictionary<NSString *, id> *record = IABatchAnalyzePage(urls[index], options);
+
+                        const NSTimeInterval latency = [NSProcessInfo processInfo].systemUptime - began;
+                        record[@"latency"] = @(latency);
+
+                        NSData *line = [NSJSONSerialization dataWithJSONObject:record options:0 error:NULL];
+                        const BOOL failed = record[@"error"] != nil;
+
+                        dispatch_sync(writer, ^{
+                            fwrite(line.bytes, 1, line.length, output);
+                            fputc('\n', output);
+
+                            [latencies addObject:@(latency)];
+                            if (failed) ++failures;
+                        });
+                    }
+                }
+            });
+        }
+
+        dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+
+        const NSTimeInterval elapsed = [NSProcessInfo processInfo].systemUptime - start;
+
+        if (output != stdout) fclose(output);
+        else fflush(output);
+
+        NSArray<NSNumber *> *sorted = [latencies sortedArrayUsingSelector:@selector(compare:)];
+
+        fprintf(stderr, "ia-batch: %lu pages (%lu failed) in %.3f s on %lu workers: %.2f pages/s\n",
+                (unsigned long)urls.count, (unsigned long)failures, elapsed, (unsigned long)MIN(options.workers, urls.count), urls.count / elapsed);
+        fprintf(stderr, "ia-batch: latency p50 %.3f s, p90 %.3f s, p99 %.3f s, max %.3f s\n",
+                IAToolPercentile(sorted, 0.50), IAToolPercentile(sorted, 0.90), IAToolPercentile(sorted, 0.99), sorted.lastObject.doubleValue);
+
+        return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,613 @@
+//
+//  main.m
+//  ia-bench
+//
+//  Created by Rob Menke on 10/18/26.
+//  Copyright © 2026 Rob Menke. All rights reserved.
+//
+
+@import Foundation;
+@import ImageAnalysisKit;
+
+#import "IAToolSupport.h"
+
+#include <getopt.h>
+#include <stdatomic.h>
+#include <sys/resource.h>
+#include <sys/sysctl.h>
+#include <sysexits.h>
+
+// Generates synthetic pages of bordered panels with known frames, runs
+// the border mask, closing, and Hough stages over them, and writes the
+// throughput, latency, memory, and recall of each page size as a JSON
+// object that can be compared across commits.
+
+static const char *usage =
+    "usage: ia-bench [-r megapixels,...] [-c pages] [-n panels] [-a degrees] [-t thickness]\n"
+    "                [-g gap] [-e noise] [-j workers] [-p params.json] [-s name=value]...\n"
+    "                [-k kernel] [-f fuzz] [-i iou] [-S seed] [-C label] [-o output.json]\n"
+    "\n"
+    "  -r list      page sizes in megapixels, comma-separated (default: 1,4,16)\n"
+    "  -c pages     pages generated for each size (default: 10)\n"
+    "  -n panels    panels on each page (default: 6)\n"
+    "  -a degrees   greatest rotation of a page, either way (default: 0.5)\n"
+    "  -t pixels    thickness of the panel borders (default: 4)\n"
+    "  -g pixels    length of the break cut into each side of a panel, 0 for none (default: 0)\n"
+    "  -e fraction  fraction of pixels replaced by black or white noise (default: 0.0005)\n"
+    "  -j workers   pages analyzed at once (default: 1)\n"
+    "  -p file      JSON object of analysis parameters\n"
+    "  -s name=val  set one analysis parameter (may be repeated)\n"
+    "  -k kernel    size of the closing applied to the border mask, 0 for none (default: 3)\n"
+    "  -f fuzz      border mask fuzziness (default: 13.7)\n"
+    "  -i iou       overlap a region needs to count as finding a panel (default: 0.75)\n"
+    "  -S seed      seed for the page generator (default: 1)\n"
+    "  -C label     recorded in the output to identify the build, e.g. a commit hash\n"
+    "  -o file      write the results here instead of standard output\n";
+
+@interface IABenchOptions : NSObject
+
+@property (nonatomic) NSUInteger pages;
+@property (nonatomic) NSUInteger panels;
+@property (nonatomic) double rotation;
+@property (nonatomic) double thickness;
+@property (nonatomic) double gap;
+@property (nonatomic) double noise;
+@property (nonatomic) NSUInteger workers;
+@property (nonatomic) NSUInteger kernelSize;
+@property (nonatomic) float fuzziness;
+@property (nonatomic) double threshold;
+@property (nonatomic) unsigned long seed;
+@property (nonatomic, copy) NSDictionary<NSString *, id> *parameters;
+
+@end
+
+@implementation IABenchOptions
+@end
+
+/*!
+ * @abstract What one page of a configuration produced.
+ */
+typedef struct {
+    BOOL failed;
+    double generation, latency, mask, closing, analysis;
+    NSUInteger panels, found, matched;
+} IABenchPage;
+
+#pragma mark - Generation
+
+/*!
+ * @abstract Divide @p total into @p count parts of random size.
+ * @discussion No part is less than two-thirds of the mean.
+ */
+static void IABenchSplit(double total, NSUInteger count, unsigned short xsubi[3], double *parts) {
+    double sum = 0;
+
+    for (NSUInteger i = 0; i < count; ++i) {
+        parts[i] = 1.0 + 0.5 * erand48(xsubi);
+        sum += parts[i];
+    }
+
+    for (NSUInteger i = 0; i < count; ++i) {
+        parts[i] *= total / sum;
+    }
+}
+
+/*!
+ * @abstract Lay out the panels of a page in rows.
+ * @return The frames of the panels, before rotation, with the origin
+ *   at the upper left.
+ */
+static NSArray<NSValue *> *IABenchLayout(size_t width, size_t height, IABenchOptions *options, unsigned short xsubi[3]) {
+    const NSUInteger count = MAX(options.panels, 1);
+    const NSUInteger rows = MIN(count, (NSUInteger)ceil(sqrt(1.5 * count)));
+
+    const double margin = 0.06 * width, gutter = 0.03 * width;
+
+    double heights[rows];
+    IABenchSplit(height - 2 * margin - (rows - 1) * gutter, rows, xsubi, heights);
+
+    NSMutableArray<NSValue *> *frames = [NSMutableArray arrayWithCapacity:count];
+
+    double y = margin;
+
+    for (NSUInteger row = 0; row < rows; ++row) {
+        const NSUInteger columns = count / rows + (row < count % rows);
+
+        double widths[columns];
+        IABenchSplit(width - 2 * margin - (columns - 1) * gutter, columns, xsubi, widths);
+
+        double x = margin;
+
+        for (NSUInteger column = 0; column < columns; ++column) {
+            [frames addObject:[NSValue valueWithRect:NSMakeRect(round(x), round(y), round(widths[column]), round(heights[row]))]];
+            x += widths[column] + gutter;
+        }
+
+        y += heights[row] + gutter;
+    }
+
+    return frames;
+}
+
+/*!
+ * @abstract Draw a page of bordered panels on a white ground.
+ * @param truth Receives the bounding box of each panel as drawn.
+ */
+static IABuffer *IABenchCreatePage(size_t width, size_t height, IABenchOptions *options, NSUInteger index, NSMutableArray<NSValue *> *truth, NSError **error) {
+    const uint64_t seed = options.seed * 0x9E3779B97F4A7C15ULL + index;
+    unsigned short xsubi[3] = { (unsigned short)seed, (unsigned short)(seed >> 16), (unsigned short)(seed >> 32) };
+
+    NSArray<NSValue *> *frames = IABenchLayout(width, height, options, xsubi);
+
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateWithName(kCGColorSpaceGenericGray);
+    CGContextRef context = CGBitmapContextCreate(NULL, width, height, 8, width, colorSpace, kCGImageAlphaNone);
+
+    CGColorSpaceRelease(colorSpace);
+
+    if (!context) {
+        if (error) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
+        return nil;
+    }
+
+    CGContextSetGrayFillColor(context, 1.0, 1.0);
+    CGContextFillRect(context, CGRectMake(0, 0, width, height));
+
+    // Rotate about the center of the page, with the origin at the
+    // upper left so the frames match the regions reported.
+
+    const double angle = options.rotation * (2.0 * erand48(xsubi) - 1.0) * M_PI / 180.0;
+
+    CGAffineTransform transform = CGAffineTransformMake(1, 0, 0, -1, 0, height);
+    transform = CGAffineTransformTranslate(transform, width / 2.0, height / 2.0);
+    transform = CGAffineTransformRotate(transform, angle);
+    transform = CGAffineTransformTranslate(transform, -(width / 2.0), -(height / 2.0));
+
+    CGContextConcatCTM(context, transform);
+
+    const CGAffineTransform rotation = CGAffineTransformTranslate(CGAffineTransformRotate(CGAffineTransformMakeTranslation(width / 2.0, height / 2.0), angle), -(width / 2.0), -(height / 2.0));
+
+    const double thickness = options.thickness;
+
+    for (NSValue *value in frames) {
+        const CGRect frame = value.rectValue;
+
+        // The artwork is a flat gray far enough from white that the
+        // border mask stops at it even where the border is broken.
+
+        CGContextSetGrayFillColor(context, 0.25 + 0.5 * erand48(xsubi), 1.0);
+        CGContextFillRect(context, frame);
+
+        CGContextSetGrayStrokeColor(context, 0.0, 1.0);
+        CGContextSetLineWidth(context, thickness);
+        CGContextStrokeRect(context, CGRectInset(frame, thickness / 2.0, thickness / 2.0));
+
+        if (options.gap > 0) {
+            CGContextSetGrayFillColor(context, 1.0, 1.0);
+
+            const double gap = options.gap;
+            const double h = erand48(xsubi) * MAX(frame.size.width - gap, 0);
+            const double v = erand48(xsubi) * MAX(frame.size.height - gap, 0);
+
+            CGContextFillRect(context, CGRectMake(CGRectGetMinX(frame) + h, CGRectGetMinY(frame), gap, thickness));
+            CGContextFillRect(context, CGRectMake(CGRectGetMaxX(frame) - gap - h, CGRectGetMaxY(frame) - thickness, gap, thickness));
+            CGContextFillRect(context, CGRectMake(CGRectGetMinX(frame), CGRectGetMaxY(frame) - gap - v, thickness, gap));
+            CGContextFillRect(context, CGRectMake(CGRectGetMaxX(frame) - thickness, CGRectGetMinY(frame) + v, thickness, gap));
+        }
+
+        [truth addObject:[NSValue valueWithRect:CGRectApplyAffineTransform(frame, rotation)]];
+    }
+
+    // Salt-and-pepper noise, applied after drawing so it lands on the
+    // ground, the borders, and the artwork alike.
+
+    uint8_t *pixels = CGBitmapContextGetData(context);
+    const size_t bytesPerRow = CGBitmapContextGetBytesPerRow(context);
+    const size_t noisy = (size_t)(options.noise * width * height);
+
+    for (size_t i = 0; i < noisy; ++i) {
+        const size_t x = (size_t)(erand48(xsubi) * width);
+        const size_t y = (size_t)(erand48(xsubi) * height);
+
+        pixels[y * bytesPerRow + x] = erand48(xsubi) < 0.5 ? 0 : 255;
+    }
+
+    CGImageRef image = CGBitmapContextCreateImage(context);
+    CGContextRelease(context);
+
+    if (!image) {
+        if (error) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
+        return nil;
+    }
+
+    IABuffer *buffer = [[IABuffer alloc] initWithImage:image error:error];
+
+    CGImageRelease(image);
+
+    return buffer;
+}
+
+#pragma mark - Analysis
+
+static double IABenchIntersectionOverUnion(NSRect a, NSRect b) {
+    const NSRect intersection = NSIntersectionRect(a, b);
+
+    const double i = intersection.size.width * intersection.size.height;
+    const double u = a.size.width * a.size.height + b.size.width * b.size.height - i;
+
+    return u > 0 ? i / u : 0;
+}
+
+/*!
+ * @abstract Count the panels matched by a region.
+ * @discussion Each panel is matched greedily to the unclaimed region
+ *   overlapping it most, if that overlap reaches @p threshold.
+ */
+static NSUInteger IABenchMatch(NSArray<NSValue *> *truth, NSArray<NSArray<NSNumber *> *> *regions, double threshold) {
+    NSMutableIndexSet *claimed = [NSMutableIndexSet indexSet];
+    NSUInteger matched = 0;
+
+    for (NSValue *value in truth) {
+        const NSRect panel = value.rectValue;
+
+        NSUInteger best = NSNotFound;
+        double bestScore = threshold;
+
+        for (NSUInteger i = 0; i < regions.count; ++i) {
+            if ([claimed containsIndex:i]) continue;
+
+            NSArray<NSNumber *> *r = regions[i];
+            const double score = IABenchIntersectionOverUnion(panel, NSMakeRect(r[0].doubleValue, r[1].doubleValue, r[2].doubleValue, r[3].doubleValue));
+
+            if (score >= bestScore) {
+                best = i;
+                bestScore = score;
+            }
+        }
+
+        if (best != NSNotFound) {
+            [claimed addIndex:best];
+            ++matched;
+        }
+    }
+
+    return matched;
+}
+
+static BOOL IABenchAnalyzePage(size_t width, size_t height, IABenchOptions *options, NSUInteger index, IABenchPage *page, NSError **error) {
+    NSMutableArray<NSValue *> *truth = [NSMutableArray array];
+
+    NSProcessInfo *processInfo = [NSProcessInfo processInfo];
+    const NSTimeInterval began = processInfo.systemUptime;
+
+    IABuffer *image = IABenchCreatePage(width, height, options, index, truth, error);
+    if (!image) return NO;
+
+    page->panels = truth.count;
+    page->generation = processInfo.systemUptime - began;
+
+    // Only the regions are scored, but both results are asked for so
+    // that a page costs what it does in ia-batch by default.
+
+    NSArray *segments, *regions;
+    IAToolTimings timings;
+
+    if (!IAToolAnalyzePage(image, options.fuzziness, options.kernelSize, options.parameters, IAToolResultsSegments | IAToolResultsRegions, &segments, &regions, &timings, error)) return NO;
+
+    page->mask     = timings.mask;
+    page->closing  = timings.closing;
+    page->analysis = timings.analysis;
+    page->latency  = timings.mask + timings.closing + timings.analysis;
+
+    page->found = regions.count;
+    page->matched = IABenchMatch(truth, regions, options.threshold);
+
+    return YES;
+}
+
+#pragma mark - Reporting
+
+/*!
+ * @abstract One of the times of the pages that succeeded, in ascending
+ *   order.
+ * @param offset The offset of the time in @c IABenchPage.
+ */
+static NSArray<NSNumber *> *IABenchSortedTimes(const IABenchPage *pages, NSUInteger count, size_t offset) {
+    NSMutableArray<NSNumber *> *times = [NSMutableArray arrayWithCapacity:count];
+
+    for (NSUInteger i = 0; i < count; ++i) {
+        if (!pages[i].failed) [times addObject:@(*(const double *)((const char *)&pages[i] + offset))];
+    }
+
+    return [times sortedArrayUsingSelector:@selector(compare:)];
+}
+
+static NSDictionary<NSString *, NSNumber *> *IABenchLatency(NSArray<NSNumber *> *sorted) {
+    return @{@"p50":@(IAToolPercentile(sorted, 0.50)), @"p90":@(IAToolPercentile(sorted, 0.90)), @"p99":@(IAToolPercentile(sorted, 0.99)), @"max":@(sorted.lastObject.doubleValue)};
+}
+
+/*!
+ * @abstract The largest resident set of the process so far, in bytes.
+ */
+static uint64_t IABenchPeakResidentSize(void) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+
+    return (uint64_t)usage.ru_maxrss;
+}
+
+static NSString *IABenchSysctl(const char *name) {
+    char value[256];
+    size_t length = sizeof(value);
+
+    if (sysctlbyname(name, value, &length, NULL, 0) != 0) return @"unknown";
+
+    return [[NSString alloc] initWithBytes:value length:strnlen(value, length) encoding:NSUTF8StringEncoding] ?: @"unknown";
+}
+
+#pragma mark - Configurations
+
+static NSDictionary<NSString *, id> *IABenchRun(double megapixels, IABenchOptions *options) {
+    // Pages are two wide by three high, like most trade paperbacks.
+
+    const size_t width  = MAX((size_t)round(sqrt(megapixels * 1e6 / 1.5)), 16);
+    const size_t height = MAX((size_t)round(width * 1.5), 16);
+
+    const NSUInteger count = options.pages;
+    IABenchPage *pages = calloc(count, sizeof(IABenchPage));
+
+    static atomic_size_t next;
+    atomic_store(&next, 0);
+
+    dispatch_group_t group = dispatch_group_create();
+
+    const NSTimeInterval start = [NSProcessInfo processInfo].systemUptime;
+
+    for (NSUInteger worker = 0; worker < MIN(options.workers, count); ++worker) {
+        dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+            for (size_t index; (index = atomic_fetch_add(&next, 1)) < count; ) {
+                @autoreleasepool {
+                    NSError * __autoreleasing error = nil;
+
+                    if (!IABenchAnalyzePage(width, height, options, index, &pages[index], &error)) {
+                        pages[index].failed = YES;
+                        fprintf(stderr, "ia-bench: %.1f MP page %zu: %s\n", megapixels, index, error.localizedDescription.UTF8String ?: "unknown error");
+                    }
+                }
+            }
+        });
+    }
+
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+
+    const NSTimeInterval elapsed = [NSProcessInfo processInfo].systemUptime - start;
+
+    NSUInteger failures = 0, panels = 0, found = 0, matched = 0;
+
+    for (NSUInteger i = 0; i < count; ++i) {
+        if (pages[i].failed) {
+            ++failures;
+            continue;
+        }
+
+        panels  += pages[i].panels;
+        found   += pages[i].found;
+        matched += pages[i].matched;
+    }
+
+    // Throughput is measured over the wall clock, and so includes
+    // drawing the pages; the generation times show how much of it
+    // that is.
+
+    const NSUInteger analyzed = count - failures;
+    const double pagesPerSecond = elapsed > 0 ? analyzed / elapsed : 0;
+
+    NSArray<NSNumber *> *latency = IABenchSortedTimes(pages, count, offsetof(IABenchPage, latency));
+
+    NSDictionary<NSString *, id> *result = @{
+        @"megapixels":@(width * height / 1e6),
+        @"width":@(width),
+        @"height":@(height),
+        @"pages":@(count),
+        @"failures":@(failures),
+        @"elapsed":@(elapsed),
+        @"pagesPerSecond":@(pagesPerSecond),
+        @"megapixelsPerSecond":@(pagesPerSecond * width * height / 1e6),
+        @"latency":IABenchLatency(latency),
+        @"generation":IABenchLatency(IABenchSortedTimes(pages, count, offsetof(IABenchPage, generation))),
+        @"stages":@{
+            @"mask":IABenchLatency(IABenchSortedTimes(pages, count, offsetof(IABenchPage, mask))),
+            @"closing":IABenchLatency(IABenchSortedTimes(pages, count, offsetof(IABenchPage, closing))),
+            @"analysis":IABenchLatency(IABenchSortedTimes(pages, count, offsetof(IABenchPage, analysis))),
+        },
+        @"peakResidentBytes":@(IABenchPeakResidentSize()),
+        @"panels":@(panels),
+        @"regionsFound":@(found),
+        @"recall":@(panels ? (double)matched / panels : 0),
+        @"precision":@(found ? (double)matched / found : 0),
+    };
+
+    fprintf(stderr, "ia-bench: %.1f MP: %lu pages (%lu failed), %.2f pages/s, p50 %.3f s, p99 %.3f s, recall %.3f, precision %.3f\n",
+            width * height / 1e6, (unsigned long)count, (unsigned long)failures, pagesPerSecond,
+            IAToolPercentile(latency, 0.50), IAToolPercentile(latency, 0.99),
+            [result[@"recall"] doubleValue], [result[@"precision"] doubleValue]);
+
+    free(pages);
+
+    return result;
+}
+
+int main(int argc, char * const argv[]) {
+    @autoreleasepool {
+        IABenchOptions *options = [[IABenchOptions alloc] init];
+
+        options.pages      = 10;
+        options.panels     = 6;
+        options.rotation   = 0.5;
+        options.thickness  = 4;
+        options.gap        = 0;
+        options.noise      = 0.0005;
+        options.workers    = 1;
+        options.kernelSize = 3;
+        options.fuzziness  = 13.7f;
+        options.threshold  = 0.75;
+        options.seed       = 1;
+
+        NSMutableDictionary<NSString *, id> *parameters = IAToolDefaultParameters();
+        NSMutableArray<NSNumber *> *sizes = [NSMutableArray arrayWithObjects:@1, @4, @16, nil];
+        NSString *outputPath = nil;
+        NSString *label = nil;
+
+        int ch;
+
+        while ((ch = getopt(argc, argv, "r:c:n:a:t:g:e:j:p:s:k:f:i:S:C:o:h")) != -1) {
+            NSString *arg = optarg ? @(optarg) : nil;
+
+            switch (ch) {
+                case 'r':
+                    [sizes removeAllObjects];
+
+                    for (NSString *item in [arg componentsSeparatedByString:@","]) {
+                        const double megapixels = item.doubleValue;
+
+                        if (!(megapixels > 0 && megapixels <= 400)) {
+                            fprintf(stderr, "ia-bench: %s: not a page size\n", item.UTF8String);
+                            return EX_USAGE;
+                        }
+
+                        [sizes addObject:@(megapixels)];
+                    }
+                    break;
+
+                case 'c':
+                    options.pages = MAX(arg.integerValue, 1);
+                    break;
+
+                case 'n':
+                    options.panels = MAX(arg.integerValue, 1);
+                    break;
+
+                case 'a':
+                    options.rotation = fabs(arg.doubleValue);
+                    break;
+
+                case 't':
+                    options.thickness = MAX(arg.doubleValue, 1);
+                    break;
+
+                case 'g':
+                    options.gap = MAX(arg.doubleValue, 0);
+                    break;
+
+                case 'e':
+                    options.noise = MIN(MAX(arg.doubleValue, 0), 1);
+                    break;
+
+                case 'j':
+                    options.workers = MAX(arg.integerValue, 1);
+                    break;
+
+                case 'p':
+                case 's': {
+                    const int status = IAToolParseParameterOption("ia-bench", ch, optarg, parameters);
+                    if (status != EX_OK) return status;
+                    break;
+                }
+
+                case 'k':
+                    options.kernelSize = MAX(arg.integerValue, 0);
+                    break;
+
+                case 'f':
+                    options.fuzziness = arg.floatValue;
+                    break;
+
+                case 'i':
+                    options.threshold = MIN(MAX(arg.doubleValue, 0), 1);
+                    break;
+
+                case 'S':
+                    options.seed = strtoul(optarg, NULL, 0);
+                    break;
+
+                case 'C':
+                    label = arg;
+                    break;
+
+                case 'o':
+                    outputPath = arg;
+                    break;
+
+                default:
+                    fputs(usage, stderr);
+                    return ch == 'h' ? EX_OK : EX_USAGE;
+            }
+        }
+
+        if (optind < argc) {
+            fputs(usage, stderr);
+            return EX_USAGE;
+        }
+
+        options.parameters = parameters;
+
+        // The resident set only grows, so the sizes are run from the
+        // smallest up to make each peak that of its own size.
+
+        [sizes sortUsingSelector:@selector(compare:)];
+
+        NSMutableArray<NSDictionary *> *configurations = [NSMutableArray arrayWithCapacity:sizes.count];
+        NSUInteger failures = 0;
+
+        for (NSNumber *size in sizes) {
+            @autoreleasepool {
+                NSDictionary<NSString *, id> *result = IABenchRun(size.doubleValue, options);
+                failures += [result[@"failures"] unsignedIntegerValue];
+
+                [configurations addObject:result];
+            }
+        }
+
+        NSISO8601DateFormatter *formatter = [[NSISO8601DateFormatter alloc] init];
+
+        NSDictionary<NSString *, id> *report = @{
+            @"label":label ?: [NSNull null],
+            @"date":[formatter stringFromDate:[NSDate date]],
+            @"host":@{
+                @"model":IABenchSysctl("hw.model"),
+                @"cpu":IABenchSysctl("machdep.cpu.brand_string"),
+                @"processors":@([NSProcessInfo processInfo].activeProcessorCount),
+                @"os":[NSProcessInfo processInfo].operatingSystemVersionString,
+            },
+            @"options":@{
+                @"pages":@(options.pages),
+                @"panels":@(options.panels),
+                @"rotation":@(options.rotation),
+                @"thickness":@(options.thickness),
+                @"gap":@(options.gap),
+                @"noise":@(options.noise),
+                @"workers":@(options.workers),
+                @"kernelSize":@(options.kernelSize),
+                @"fuzziness":@(options.fuzziness),
+                @"iou":@(options.threshold),
+                @"seed":@(options.seed),
+            },
+            @"parameters":parameters,
+            @"configurations":configurations,
+        };
+
+        NSData *json = [NSJSONSerialization dataWithJSONObject:report options:NSJSONWritingPrettyPrinted | NSJSONWritingSortedKeys error:NULL];
+
+        if (outputPath) {
+            if (![json writeToFile:outputPath.stringByExpandingTildeInPath atomically:YES]) {
+                fprintf(stderr, "ia-bench: %s: cannot write\n", outputPath.fileSystemRepresentation);
+                return EX_CANTCREAT;
+            }
+        }
+        else {
+            fwrite(json.bytes, 1, json.length, stdout);
+            fputc('\n', stdout);
+        }
+
+        return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+}
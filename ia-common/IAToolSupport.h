@@ -0,0 +1,68 @@
+//
+//  IAToolSupport.h
+//  ImageAnalysisKit
+//
+//  Created by Rob Menke on 10/18/26.
+//  Copyright © 2026 Rob Menke. All rights reserved.
+//
+
+@import Foundation;
+@import ImageAnalysisKit;
+
+// The option handling and page pipeline shared by ia-batch and
+// ia-bench, so that both measure the same work.
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_OPTIONS(NSUInteger, IAToolResults) {
+    IAToolResultsSegments = 1 << 0,
+    IAToolResultsRegions  = 1 << 1,
+};
+
+/*!
+ * @abstract Seconds spent in each stage of the page pipeline.
+ */
+typedef struct {
+    double mask, closing, analysis;
+} IAToolTimings;
+
+/*!
+ * @abstract The analysis parameters used unless overridden by @c -p
+ *   or @c -s.
+ */
+NSMutableDictionary<NSString *, id> *IAToolDefaultParameters(void);
+
+/*!
+ * @abstract Interpret the value of an @c -s option.
+ * @return A number if the whole string is one, otherwise the string.
+ */
+id IAToolParseValue(NSString *string);
+
+/*!
+ * @abstract Apply a @c -p (parameter file) or @c -s (name=value)
+ *   option to the analysis parameters.
+ * @param tool The name of the tool, for messages.
+ * @return @c EX_OK, or the exit status after reporting the problem
+ *   on standard error.
+ */
+int IAToolParseParameterOption(const char *tool, int option, const char *arg, NSMutableDictionary<NSString *, id> *parameters);
+
+/*!
+ * @abstract The nearest-rank percentile of values in ascending order.
+ */
+double IAToolPercentile(NSArray<NSNumber *> *sorted, double p);
+
+/*!
+ * @abstract Run a page through the border mask, the closing, and a
+ *   single analysis.
+ * @discussion When both segments and regions are asked for, the
+ *   regions are formed from the segments returned, so the page is
+ *   analyzed once and the two agree.
+ * @param kernelSize The size of the closing, or 0 or 1 for none.
+ * @param segments Receives the segments if asked for, otherwise @c nil.
+ * @param regions Receives the regions if asked for, otherwise @c nil.
+ * @param timings If not @c NULL, receives the time spent in each stage.
+ */
+BOOL IAToolAnalyzePage(IABuffer *image, float fuzziness, NSUInteger kernelSize, NSDictionary<NSString *, id> *parameters, IAToolResults results, NSArray * _Nullable * _Nonnull segments, NSArray * _Nullable * _Nonnull regions, IAToolTimings * _Nullable timings, NSError **error);
+
+NS_ASSUME_NONNULL_END
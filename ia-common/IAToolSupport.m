@@ -0,0 +1,111 @@
+//
+//  IAToolSupport.m
+//  ImageAnalysisKit
+//
+//  Created by Rob Menke on 10/18/26.
+//  Copyright © 2026 Rob Menke. All rights reserved.
+//
+
+#import "IAToolSupport.h"
+
+#include <sysexits.h>
+
+NSMutableDictionary<NSString *, id> *IAToolDefaultParameters(void) {
+    return [@{@"sensitivity":@12, @"maxGap":@2, @"minSegmentLength":@20, @"channelWidth":@3} mutableCopy];
+}
+
+id IAToolParseValue(NSString *string) {
+    NSScanner *scanner = [NSScanner scannerWithString:string];
+    double value;
+
+    if ([scanner scanDouble:&value] && scanner.atEnd) return @(value);
+
+    return string;
+}
+
+int IAToolParseParameterOption(const char *tool, int option, const char *arg, NSMutableDictionary<NSString *, id> *parameters) {
+    NSString *string = @(arg);
+
+    if (option == 'p') {
+        NSData *data = [NSData dataWithContentsOfFile:string.stringByExpandingTildeInPath];
+        NSDictionary *values = data ? [NSJSONSerialization JSONObjectWithData:data options:0 error:NULL] : nil;
+
+        if (![values isKindOfClass:[NSDictionary class]]) {
+            fprintf(stderr, "%s: %s: not a JSON object\n", tool, arg);
+            return EX_DATAERR;
+        }
+
+        [parameters addEntriesFromDictionary:values];
+        return EX_OK;
+    }
+
+    NSRange equals = [string rangeOfString:@"="];
+
+    if (equals.location == NSNotFound) {
+        fprintf(stderr, "%s: %s: expected name=value\n", tool, arg);
+        return EX_USAGE;
+    }
+
+    parameters[[string substringToIndex:equals.location]] = IAToolParseValue([string substringFromIndex:NSMaxRange(equals)]);
+    return EX_OK;
+}
+
+double IAToolPercentile(NSArray<NSNumber *> *sorted, double p) {
+    if (sorted.count == 0) return 0;
+
+    // The nearest-rank definition.
+
+    const NSUInteger rank = MIN((NSUInteger)ceil(p * sorted.count), sorted.count);
+    return sorted[rank ? rank - 1 : 0].doubleValue;
+}
+
+BOOL IAToolAnalyzePage(IABuffer *image, float fuzziness, NSUInteger kernelSize, NSDictionary<NSString *, id> *parameters, IAToolResults results, NSArray **segments, NSArray **regions, IAToolTimings *timings, NSError **error) {
+    *segments = nil;
+    *regions  = nil;
+
+    NSProcessInfo *processInfo = [NSProcessInfo processInfo];
+    IAToolTimings elapsed = { 0, 0, 0 };
+
+    NSTimeInterval now = processInfo.systemUptime;
+
+    IABuffer *mask = [image extractBorderMaskWithFuzziness:fuzziness ROI:NSMakeRect(0, 0, image.width, image.height) error:error];
+    if (!mask) return NO;
+
+    elapsed.mask = processInfo.systemUptime - now;
+    now = processInfo.systemUptime;
+
+    if (kernelSize > 1) {
+        const NSSize kernel = NSMakeSize(kernelSize, kernelSize);
+
+        mask = [mask dilateWithKernelSize:kernel error:error];
+        if (!mask) return NO;
+
+        mask = [mask erodeWithKernelSize:kernel error:error];
+        if (!mask) return NO;
+    }
+
+    elapsed.closing = processInfo.systemUptime - now;
+    now = processInfo.systemUptime;
+
+    switch (results) {
+        case IAToolResultsSegments:
+            *segments = [mask extractSegmentsWithParameters:parameters error:error];
+            if (!*segments) return NO;
+            break;
+
+        case IAToolResultsRegions:
+            *regions = [mask extractRegionsWithParameters:parameters error:error];
+            if (!*regions) return NO;
+            break;
+
+        default:
+            if (![mask extractSegments:segments regions:regions withParameters:parameters error:error]) return NO;
+            break;
+    }
+
+    elapsed.analysis = processInfo.systemUptime - now;
+
+    if (timings) *timings = elapsed;
+
+    return YES;
+}